@@ -1,31 +1,35 @@
-/* Keep the webcam from locking up when you interrupt a frame capture */
-//volatile int quit_signal=0;
-
 #include "opencv2/opencv.hpp"
 #include "opencv2/gpu/gpu.hpp"
-#include <sys/time.h>
+#include "../common/balloonyness.h"
 #include <cstdio>
 #include <cmath>
 #include <cstdarg>
 #include <ctype.h>
 #include <stdio.h>
 #include <iostream>
-//#include <signal.h>
-//extern "C" void quit_signal_handler(int signum) {
-//	if (quit_signal!=0) exit(0); // just exit already
-//	quit_signal=1;
-//	printf("Will quit at next camera frame (repeat to kill now)\n");
-//}
+#include <unistd.h>
+#include <thread>
+#include <atomic>
+#include "../common/pipeline.h"
+#include "../common/blobs.h"
+#include "../common/balloonDetector.h"
+#include "../common/roiScheduler.h"
+#include "../common/pyramidDetector.h"
+#include "../common/runOptions.h"
+#include "../common/detectionLog.h"
+#include "../common/latency.h"
+#include "../common/frameInput.h"
+#include <signal.h>
 
 using namespace cv;
 using namespace std;
 
 #define FEED_SIZE 3
-#define PER_FRAME_TIME_LOGGING 0
-#define SHOW_FEED_WINDOW 0
-#define SHOW_OTHER_WINDOWS 0
-#define SHOW_OUTPUT_WINDOW 1
-#define DRAW_DEBUG_DATA 1
+#define USE_GPU 0 //1 runs the colour chain on the cuda device, 0 uses the fused cpu kernel
+#define DETECTOR_THREADS 0 //threads the cpu strip detector uses, 0 uses every core
+#define ROI_TRACKING 1 //1 only scans a predicted window around a confirmed balloon (cpu detector only)
+#define ROI_RESCAN_INTERVAL 30 //frames between full frame scans while tracking
+#define PYRAMID_MIN_RADIUS 4 //smallest balloon radius full frame scans must find, sets the coarse scale. 0 scans at full resolution
 
 #if (FEED_SIZE == 1)
 
@@ -55,73 +59,105 @@ const int FEED_HEIGHT = 1080;
 
 #endif
 
-double avgCaptureTime = 0,
-		avgConversionTime = 0,
-		avgSplitTime = 0,
-		avgProcessingTime = 0,
-		avgDisplayTime = 0;
+/*
+ * frame handed from the capture stage to the processing stage through the
+ * mailbox. The view shares the capture buffer, nothing is copied on the way
+ */
+struct CapturedFrame {
+	FrameView frame;
+	int seq;
+	int64 stamp; //capture time in microseconds
+};
+
+/*
+ * everything the display stage needs from one processed frame. The feed is a
+ * view of the capture buffer, the rest are copies owned by the display stage
+ */
+struct ProcessedFrame {
+	FrameView feed;
+	Mat hue, sat, val, balloonyness;
+	Mat debugOverlay;
+};
+
+//stages: capture -> (latest frame mailbox) -> process -> (queue) -> display on the main thread
+LatestMailbox<CapturedFrame> captured;
+SpscQueue<ProcessedFrame, 4> processed;
+std::atomic<bool> running(true);
+
+//windows, drawing and logging are chosen on the command line, see common/runOptions.h
+RunOptions opts;
+DetectionLog detectionLog;
+FILE *statusOut = stdout; //stderr when the detections go to stdout
 
-long captureTime = 0,
-		conversionTime = 0,
-		splitTime = 0,
-		processingTime = 0,
-		displayTime = 0;
+/*
+ * Keep the webcam from locking up when you interrupt a frame capture: ctrl-C
+ * stops the stages after their current frame, a second one quits straight away
+ */
+extern "C" void quit_signal_handler(int /*signum*/) {
+	if (!running) {
+		_exit(1);
+	}
+	running = false;
+}
 
-int nFrames = 0;
+//per stage latency histograms, see common/latency.h
+LatencyStage captureLatency("capture"),
+		processWaitLatency("process wait"),
+		conversionLatency("color conversion"),
+		splitLatency("split planes"),
+		detectLatency("strip detector"),
+		processingLatency("frame processing"),
+		drawLatency("overlay drawing"),
+		displayWaitLatency("display wait"),
+		displayLatency("display");
+
+int nCaptured = 0,
+		nCaptureDropped = 0,
+		nProcessed = 0,
+		nDisplayed = 0,
+		nDisplayDropped = 0,
+		nFullScans = 0;
+
+int64 scannedPixels = 0;
 
 const double areaRatio = 0.65;
 
 void initGUI() {
-#if (SHOW_FEED_WINDOW == 1)
-	namedWindow("feed");
-#endif
-#if (SHOW_OTHER_WINDOWS == 1)
-	namedWindow("hue");
-	namedWindow("sat");
-	namedWindow("val");
-	namedWindow("balloonyness");
-#endif
-#if (SHOW_OUTPUT_WINDOW == 1)
-	namedWindow("debugOverlay");
-#endif
-}
-
-void recordTime(long delta, double *avgTime) {
-	*avgTime = (*avgTime * nFrames + delta) / (nFrames + 1);
-}
-
-long getTimeDelta(struct timeval timea, struct timeval timeb) {
-	return 1000000 * (timeb.tv_sec - timea.tv_sec) +
-			(int(timeb.tv_usec) - int(timea.tv_usec));
+	if (opts.showFeed) {
+		namedWindow("feed");
+	}
+	if (opts.showOther) {
+		namedWindow("hue");
+		namedWindow("sat");
+		namedWindow("val");
+		namedWindow("balloonyness");
+	}
+	if (opts.showOutput) {
+		namedWindow("debugOverlay");
+	}
 }
 
 void log(const char* msg, ...) {
-#if (PER_FRAME_TIME_LOGGING == 1)
+	if (!opts.logTimes) {
+		return;
+	}
 	va_list args;
 	va_start(args, msg);
-	printf(msg, args);
-#endif
+	vfprintf(statusOut, msg, args);
+	va_end(args);
 }
 
-void captureFrame(VideoCapture &camera, Mat &frame_host, gpu::GpuMat &frame, Mat &debugOverlay) {
-	struct timeval timea, timeb;
-
-	gettimeofday(&timea, NULL);
-	camera >> frame_host;
-	//if (quit_signal) exit(0); // exit cleanly on interrupt
-	debugOverlay = frame_host.clone();
-	frame.upload(frame_host);
-	gettimeofday(&timeb, NULL);
-
-	captureTime = getTimeDelta(timea, timeb);
-	log("capture frame time used:\t%ld\n", captureTime);
+bool captureFrame(FrameSource &camera, FrameView &frame, int64 &stamp) {
+	ScopedLatency timer(captureLatency);
+	bool ok = camera.read(frame, stamp);
+	log("capture frame time used:\t%ld\n", timer.stop());
+	return ok;
 }
 
 /*
  * function to convert rgb input frame into three separate HSV channels
  */
 void convertToHSV(gpu::GpuMat &frame, gpu::GpuMat &hue, gpu::GpuMat &sat, gpu::GpuMat &val) {
-	struct timeval timea, timeb;
 	gpu::GpuMat hsv;
 
 	vector<gpu::GpuMat> hsvplanes(3);
@@ -129,34 +165,62 @@ void convertToHSV(gpu::GpuMat &frame, gpu::GpuMat &hue, gpu::GpuMat &sat, gpu::G
 	hsvplanes[1] = sat;
 	hsvplanes[2] = val;
 
-	gettimeofday(&timea, NULL);
+	ScopedLatency conversionTimer(conversionLatency);
 	gpu::cvtColor(frame, hsv, CV_BGR2HSV);
-	gettimeofday(&timeb, NULL);
+	log("color conversion time used:\t%ld\n", conversionTimer.stop());
 
-	conversionTime = getTimeDelta(timea, timeb);
-	log("color conversion time used:\t%ld\n", conversionTime);
-
-	gettimeofday(&timea, NULL);
+	ScopedLatency splitTimer(splitLatency);
 	gpu::split(hsv, hsvplanes);
 	hue = hsvplanes[0];
 	sat = hsvplanes[1];
 	val = hsvplanes[2];
-	gettimeofday(&timeb, NULL);
+	log("split planes time used:   \t%ld\n", splitTimer.stop());
+}
+
+/*
+ * cpu replacement for convertToHSV, the colour part of processFrame and the blob search.
+ * Runs the fused kernel and the blob analyser strip by strip on every core, see
+ * common/balloonDetector.h. Full frame scans go coarse to fine (common/pyramidDetector.h),
+ * thresh_host is then the coarse mask
+ */
+void computeCandidates(BalloonDetector &detector, PyramidDetector &pyramid, Rect window,
+		const Mat &frame_host, Mat &thresh_host, vector< Blob > &blobs) {
+	ScopedLatency timer(detectLatency);
+	if (window.size() == frame_host.size()) {
+		pyramid.detect(frame_host, window, thresh_host, blobs);
+	} else {
+		detector.detect(frame_host, window, thresh_host, blobs);
+	}
+	log("strip detector time used:\t%ld\n", timer.stop());
+}
+
+/*
+ * draws the round candidate blobs on the overlay
+ */
+void drawBalloons(const vector< Blob > &blobs, Mat &debugOverlay) {
+	for (int n = 0; n < blobs.size(); ++n) {
+		Point2f center = blobs[n].centroid();
+		float radius = blobs[n].radius();
+
+		if (opts.drawDebug) {
+			rectangle(debugOverlay, blobs[n].bounds(), Scalar(255, 0, 0));
+			circle(debugOverlay, center, radius, Scalar(0, 255, 255));
+		}
 
-	splitTime = getTimeDelta(timea, timeb);
-	log("split planes time used:   \t%ld\n", splitTime);
+		if (blobs[n].roundness() >= areaRatio) {
+			circle(debugOverlay, center, radius, Scalar(0, 255, 0), 2);
+		}
+	}
 }
 
 /*
  * process separate input channels and applies overlay on candidate contour areas
  */
-void processFrame(gpu::GpuMat &hue, gpu::GpuMat &sat, gpu::GpuMat &balloonyness, Mat &debugOverlay) {
-	struct timeval timea, timeb;
+void processFrame(BlobAnalyser &analyser, gpu::GpuMat &hue, gpu::GpuMat &sat, gpu::GpuMat &balloonyness, vector< Blob > &blobs) {
+	ScopedLatency timer(processingLatency);
 	gpu::GpuMat huered, scalehuered, scalesat, thresh;
 	Mat thresh_host;
-	vector< vector< Point > > contours;
 
-	gettimeofday(&timea, NULL);
 
 	gpu::absdiff(hue, Scalar(90), huered);
 	gpu::divide(huered, Scalar(4), scalehuered);
@@ -165,122 +229,269 @@ void processFrame(gpu::GpuMat &hue, gpu::GpuMat &sat, gpu::GpuMat &balloonyness,
 	gpu::threshold(balloonyness, thresh, 200, 255, THRESH_BINARY);
 	thresh.download(thresh_host);
 
-	findContours(thresh_host, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE);
+	analyser.analyse(thresh_host, blobs);
 
-#if (DRAW_DEBUG_DATA == 1)
-	drawContours(debugOverlay, contours, -1, Scalar(255, 0, 0));
-#endif
+	log("frame processing time used:\t%ld\n", timer.stop());
+}
+
+/*
+ * draws the blobs of one frame, the window that was searched and the tracked balloon
+ * (target, -1 for none). fineWindows are the windows a coarse to fine scan looked in
+ */
+void drawOverlay(const vector< Blob > &blobs, int target, Rect window,
+		const vector< Rect > &fineWindows, Mat &debugOverlay) {
+	ScopedLatency timer(drawLatency);
+	drawBalloons(blobs, debugOverlay);
+	if (opts.drawDebug) {
+		if (window.size() == debugOverlay.size()) {
+			for (int n = 0; n < fineWindows.size(); ++n) {
+				rectangle(debugOverlay, fineWindows[n], Scalar(255, 255, 255));
+			}
+		} else {
+			rectangle(debugOverlay, window, Scalar(255, 0, 255));
+		}
+	}
+	if (target >= 0) {
+		circle(debugOverlay, blobs[target].centroid(), 3, Scalar(0, 0, 255), -1);
+	}
+	log("overlay drawing time used:\t%ld\n", timer.stop());
+}
 
-	vector< Point2f > circleCenters(contours.size());
-	vector< float > circleRadii(contours.size());
-	Point2f center;
-	float radius;
-	for (int n = 0; n < contours.size(); ++n) {
-		minEnclosingCircle(contours[n], center, radius);
+void displayOutput(ProcessedFrame &out) {
+	ScopedLatency timer(displayLatency);
 
-#if (DRAW_DEBUG_DATA == 1)
-		circle(debugOverlay, center, radius, Scalar(0, 255, 255));
+	if (opts.showFeed) {
+		imshow("feed", out.feed.image());
+	}
+	if (opts.showOther) {
+#if (USE_GPU == 1)
+		imshow("hue", out.hue);
+		imshow("sat", out.sat);
+		imshow("val", out.val);
 #endif
+		imshow("balloonyness", out.balloonyness);
+	}
+	if (opts.showOutput) {
+		imshow("debugOverlay", out.debugOverlay);
+	}
 
-		if (contourArea(contours[n]) >= areaRatio * radius*radius*3.1415926) {
-			circle(debugOverlay, center, radius, Scalar(0, 255, 0), 2);
+	log("display frame time used:\t%ld\n", timer.stop());
+}
+
+/*
+ * capture stage thread. Never waits on the other stages, if the processing
+ * stage hasn't taken the last frame yet it gets replaced by the new one.
+ * Files and recordings replayed with --fast aren't real time, there every
+ * frame is waited for so a run measures throughput instead of dropping
+ */
+void captureStage(FrameInput &camera) {
+	while (running) {
+		if (!camera.isRealtime() && !captured.waitTaken(running)) {
+			break;
+		}
+		CapturedFrame &slot = captured.writeSlot();
+		//a frame that was never taken gives its buffer back before we wait for the next
+		slot.frame.release();
+		if (!captureFrame(camera, slot.frame, slot.stamp) || slot.frame.empty()) {
+			running = false;
+			captured.wakeAll();
+			break;
+		}
+		slot.seq = nCaptured;
+		if (captured.publish()) {
+			++nCaptureDropped;
 		}
+		++nCaptured;
 	}
-
-	gettimeofday(&timeb, NULL);
-	processingTime = getTimeDelta(timea, timeb);
-	log("frame processing time used:\t%ld\n", processingTime);
 }
 
-void displayOutput(Mat frame, gpu::GpuMat hue, gpu::GpuMat sat, gpu::GpuMat val, gpu::GpuMat balloonyness, Mat debugOverlay) {
-	struct timeval timea, timeb;
+/*
+ * processing stage thread. Waits for the newest captured frame, runs the
+ * detector on it and hands copies of the results to the display stage. If the
+ * display stage is behind the results are dropped rather than waited on
+ */
+void processStage(BalloonDetector &detector) {
+	Mat thresh_host;
+	vector< Blob > blobs; //kept between frames so it keeps its capacity
+	vector< Detection > detections;
+	const vector< Rect > noWindows;
+	BlobAnalyser analyser;
+	RoiParams roiParams;
+	roiParams.minRoundness = areaRatio;
+	roiParams.rescanInterval = ROI_RESCAN_INTERVAL;
+	RoiScheduler roi(roiParams);
+	Rect window;
+	PyramidParams pyramidParams;
+	pyramidParams.minRadius = PYRAMID_MIN_RADIUS;
+	PyramidDetector pyramid(detector, pyramidParams);
+	log("full frame scans downscaled by: %d\n", pyramid.factor());
+	gpu::GpuMat frame, hue, sat, val, balloonyness;
+
+	while (running) {
+		ScopedLatency waitTimer(processWaitLatency);
+		if (!captured.waitTake(running)) {
+			break;
+		}
+		log("process wait time:\t%ld\n", waitTimer.stop());
 
-	gettimeofday(&timea, NULL);
+		CapturedFrame &in = captured.readSlot();
+		const Mat &frame_host = in.frame.image();
+		int target = -1;
 
-#if (SHOW_FEED_WINDOW == 1)
-	imshow("feed", frame);
-#endif
-#if (SHOW_OTHER_WINDOWS ==1)
-	Mat hue_host, sat_host, val_host, balloonyness_host;
-	hue.download(hue_host);
-	sat.download(sat_host);
-	val.download(val_host);
-	balloonyness.download(balloonyness_host);
-	imshow("hue", hue_host);
-	imshow("sat", sat_host);
-	imshow("val", val_host);
-	imshow("balloonyness", balloonyness_host);
-#endif
-#if (SHOW_OUTPUT_WINDOW == 1)
-	imshow("debugOverlay", debugOverlay);
+#if (USE_GPU == 1)
+		frame.upload(frame_host);
+		convertToHSV(frame, hue, sat, val);
+		processFrame(analyser, hue, sat, balloonyness, blobs);
+		window = Rect(Point(0, 0), frame_host.size());
+#else
+#if (ROI_TRACKING == 1)
+		window = roi.nextWindow(frame_host.size());
+#else
+		window = Rect(Point(0, 0), frame_host.size());
 #endif
+		computeCandidates(detector, pyramid, window, frame_host, thresh_host, blobs);
+		roi.update(blobs);
+		target = roi.target();
 
-	gettimeofday(&timeb, NULL);
-	displayTime = getTimeDelta(timea, timeb);
-	log("display frame time used:\t%ld\n", displayTime);
-}
+		if (window.size() == frame_host.size()) {
+			++nFullScans;
+		}
+		scannedPixels += window.area();
+#endif
 
-int main() {
-	//signal(SIGINT,quit_signal_handler); // listen for ctrl-C
+		if (detectionLog.isOpen()) {
+			blobsToDetections(blobs, areaRatio, detections);
+			detectionLog.write(in.seq, in.stamp, detections);
+		}
 
-	struct timeval timea, timeb, startTime, endTime;
-	gettimeofday(&startTime, NULL);
+		//headless runs stop here, nothing is copied or drawn
+		if (opts.anyWindow()) {
+			ProcessedFrame out;
+			if (opts.showOutput) {
+				out.debugOverlay = frame_host.clone();
+				drawOverlay(blobs, target, window,
+						window.size() == frame_host.size() ? pyramid.fineWindows() : noWindows,
+						out.debugOverlay);
+			}
+			if (opts.showFeed) {
+				out.feed = in.frame;
+			}
+			if (opts.showOther) {
+#if (USE_GPU == 1)
+				hue.download(out.hue);
+				sat.download(out.sat);
+				val.download(out.val);
+				balloonyness.download(out.balloonyness);
+#else
+				out.balloonyness = thresh_host.clone();
+#endif
+			}
+			if (!processed.push(out)) {
+				++nDisplayDropped;
+			}
+		}
+		in.frame.release();
 
-	Mat frame_host, thresh_host, debugOverlay;
-	gpu::GpuMat frame, hsv, hue, sat, val, huered, scalehuered, scalesat, balloonyness, thresh;
+		++nProcessed;
+		if (opts.statsInterval > 0 && nProcessed % opts.statsInterval == 0) {
+			fprintf(statusOut, "after %d frames:\n", nProcessed);
+			dumpLatencyStats(statusOut);
+		}
+	}
+}
 
-	VideoCapture camera;
-	camera.open(0);
-	if( camera.isOpened() ){
-	            cout << ": width=" << camera.get(CV_CAP_PROP_FRAME_WIDTH) <<
-	                ", height=" << camera.get(CV_CAP_PROP_FRAME_HEIGHT) <<
-	                ", nframes=" << camera.get(CV_CAP_PROP_FRAME_COUNT) << endl;
-	} else {
-		cout << "camera not opened" << endl;
+int main(int argc, char **argv) {
+	vector< string > args;
+	if (!parseRunOptions(argc, argv, opts, args)) {
+		return(1);
+	}
+	if (opts.detectionsPath == "-") {
+		statusOut = stderr;
+	}
+	if (!opts.detectionsPath.empty() && !detectionLog.open(opts.detectionsPath, opts.detectionsFormat)) {
+		return(1);
+	}
+	signal(SIGINT, quit_signal_handler); // listen for ctrl-C
+
+	int64 startTime = monotonicMicros();
+
+	//the camera, a recording or a video file, see common/frameInput.h
+	FrameInputOptions inputOptions;
+	inputOptions.input = opts.input;
+	inputOptions.fast = opts.replayFast;
+	inputOptions.recordPath = opts.recordPath;
+	inputOptions.v4l2 = opts.v4l2Capture;
+	FrameInput camera;
+	if (!camera.open(inputOptions, Size(FEED_WIDTH, FEED_HEIGHT))) {
+		fprintf(statusOut, "camera not opened\n");
 		return(1);
 	}
-	camera.set(CV_CAP_PROP_FRAME_WIDTH, FEED_WIDTH);
-	camera.set(CV_CAP_PROP_FRAME_HEIGHT, FEED_HEIGHT);
+	fprintf(statusOut, ": width=%d, height=%d, capture=%s\n", camera.size().width,
+			camera.size().height, camera.name());
 
 	log("optimized code: %d\n", useOptimized());
 	log("cuda devices: %d\n", gpu::getCudaEnabledDeviceCount());
 	log("current device: %d\n", gpu::getDevice());
 
-	initGUI();
+	BalloonDetector detector(BalloonynessParams(), DETECTOR_THREADS);
+	log("balloonyness kernel: %s\n", balloonynessPathName(detector.balloonynessKernel().path()));
+	log("detector threads: %d\n", detector.threads());
+
+	if (opts.anyWindow()) {
+		initGUI();
+	}
 	log("starting balloon recognition\n");
 
-	while(true) {
-		captureFrame(camera, frame_host, frame, debugOverlay);
-		convertToHSV(frame, hue, sat, val);
-		processFrame(hue, sat, balloonyness, debugOverlay);
-		displayOutput(frame_host, hue, sat, val, balloonyness, debugOverlay);
+	std::thread captureThread(captureStage, std::ref(camera));
+	std::thread processThread(processStage, std::ref(detector));
 
-		recordTime(captureTime, &avgCaptureTime);
-		recordTime(conversionTime, &avgConversionTime);
-		recordTime(splitTime, &avgSplitTime);
-		recordTime(processingTime, &avgProcessingTime);
-		recordTime(displayTime, &avgDisplayTime);
+	//display stage stays on the main thread, highgui wants imshow and waitKey there
+	ProcessedFrame out;
+	int64 waitStart = monotonicMicros();
+	while (running && !opts.anyWindow()) {
+		usleep(10000);
+	}
+	while(running) {
+		if (processed.pop(out)) {
+			long displayWait = long(monotonicMicros() - waitStart);
+			displayWaitLatency.record(displayWait);
+			log("display wait time:\t%ld\n", displayWait);
 
-		++nFrames;
+			displayOutput(out);
 
-		if (waitKey(3) >= 0) {
-			break;
+			++nDisplayed;
+			waitStart = monotonicMicros();
 		}
 
+		if (waitKey(3) >= 0) {
+			running = false;
+			captured.wakeAll();
+		}
 	}
 
-	gettimeofday(&endTime, NULL);
-	long totalTimeUsec = getTimeDelta(startTime, endTime);
+	captureThread.join();
+	processThread.join();
+	detectionLog.close();
+
+	long totalTimeUsec = long(monotonicMicros() - startTime);
 	double totalTimeSec = double(totalTimeUsec)/1000000.0;
 
-	printf("key press detected. printing statistics.\n");
-	printf("%d frames captured over %ld microseconds (%lf seconds)\n", nFrames,
+	fprintf(statusOut, "stopped. printing statistics.\n");
+	fprintf(statusOut, "%d frames captured over %ld microseconds (%lf seconds)\n", nCaptured,
 			totalTimeUsec, totalTimeSec);
-	printf("ran at %lf Frames per Second\n", nFrames/totalTimeSec);
-	printf("average capture frame time used:\t%lf\n", avgCaptureTime);
-	printf("average color conversion time used:\t%lf\n", avgConversionTime);
-	printf("average split planes time used:  \t%lf\n", avgSplitTime);
-	printf("average ubuframe processing time used:\t%lf\n", avgProcessingTime);
-	printf("average display frame time used:\t%lf\n", avgDisplayTime);
-	printf("terminating...\n");
+	fprintf(statusOut, "%d frames processed (%d stale frames skipped), %d displayed (%d dropped)\n",
+			nProcessed, nCaptureDropped, nDisplayed, nDisplayDropped);
+	fprintf(statusOut, "ran at %lf Frames per Second\n", nProcessed/totalTimeSec);
+	if (camera.skipped() > 0) {
+		fprintf(statusOut, "%d recorded frames were due before they were read\n", camera.skipped());
+	}
+	if (!opts.recordPath.empty()) {
+		fprintf(statusOut, "%d frames recorded to %s\n", camera.recorded(), opts.recordPath.c_str());
+	}
+#if (USE_GPU == 0)
+	fprintf(statusOut, "%d full frame scans, average pixels scanned per frame:\t%lf\n", nFullScans,
+			nProcessed ? double(scannedPixels) / nProcessed : 0.0);
+#endif
+	dumpLatencyStats(statusOut);
+	fprintf(statusOut, "terminating...\n");
 }
@@ -0,0 +1,136 @@
+/*
+ * Bit exact check of the fused balloonyness kernel
+ * Description:
+ * Runs the original cvtColor/split/absdiff/divide/multiply/threshold chain
+ * and every row kernel this cpu supports, and compares the candidate masks.
+ * The test frame holds every possible BGR value once (4096x4096), any extra
+ * images given on the command line are checked as well. If a cuda device is
+ * present the gpu version of the chain is compared too.
+ *
+ * Usage:
+ *    make testBalloonyness
+ *    ./testBalloonyness [image ...]
+ */
+#include "opencv2/opencv.hpp"
+#include "opencv2/gpu/gpu.hpp"
+#include "../common/balloonyness.h"
+#include <stdio.h>
+
+using namespace cv;
+using namespace std;
+
+const int timingRuns = 10;
+
+/*
+ * the chain processFrame used before the fused kernel, on the cpu
+ */
+void referenceChain(const Mat &frame, Mat &thresh) {
+	Mat hsv, huered, scalehuered, scalesat, balloonyness;
+	vector<Mat> hsvplanes(3);
+
+	cvtColor(frame, hsv, CV_BGR2HSV);
+	split(hsv, hsvplanes);
+	absdiff(hsvplanes[0], Scalar(90), huered);
+	divide(huered, Scalar(4), scalehuered);
+	divide(hsvplanes[1], Scalar(16), scalesat);
+	multiply(scalehuered, scalesat, balloonyness);
+	threshold(balloonyness, thresh, 200, 255, THRESH_BINARY);
+}
+
+/*
+ * same chain on the gpu, as it is in IdentifyBalloon_Camera/Main.cpp
+ */
+void referenceChainGpu(const Mat &frame, Mat &thresh) {
+	gpu::GpuMat gframe, hsv, huered, scalehuered, scalesat, balloonyness, gthresh;
+	vector<gpu::GpuMat> hsvplanes(3);
+
+	gframe.upload(frame);
+	gpu::cvtColor(gframe, hsv, CV_BGR2HSV);
+	gpu::split(hsv, hsvplanes);
+	gpu::absdiff(hsvplanes[0], Scalar(90), huered);
+	gpu::divide(huered, Scalar(4), scalehuered);
+	gpu::divide(hsvplanes[1], Scalar(16), scalesat);
+	gpu::multiply(scalehuered, scalesat, balloonyness);
+	gpu::threshold(balloonyness, gthresh, 200, 255, THRESH_BINARY);
+	gthresh.download(thresh);
+}
+
+int countMismatches(const Mat &a, const Mat &b) {
+	Mat diff;
+	compare(a, b, diff, CMP_NE);
+	return countNonZero(diff);
+}
+
+/*
+ * compares every supported row kernel against the reference mask for one frame
+ * returns the number of kernels that did not match
+ */
+int checkFrame(const string &name, const Mat &frame) {
+	int failures = 0;
+	Mat ref, out;
+	int64 t;
+
+	t = getTickCount();
+	for (int i = 0; i < timingRuns; i++)
+		referenceChain(frame, ref);
+	double refTime = (getTickCount() - t) * 1000. / getTickFrequency() / timingRuns;
+
+	printf("%s (%dx%d)\n", name.c_str(), frame.cols, frame.rows);
+	printf("\treference chain  %8.3f ms\n", refTime);
+
+	if (gpu::getCudaEnabledDeviceCount() > 0) {
+		referenceChainGpu(frame, out);
+		int bad = countMismatches(ref, out);
+		printf("\tgpu chain        mismatches %d\n", bad);
+	}
+
+	for (int path = BALLOONYNESS_SCALAR; path < BALLOONYNESS_NPATHS; path++) {
+		if (!balloonynessPathSupported(path))
+			continue;
+		BalloonynessKernel kernel(BalloonynessParams(), path);
+
+		t = getTickCount();
+		for (int i = 0; i < timingRuns; i++)
+			kernel.apply(frame, out);
+		double time = (getTickCount() - t) * 1000. / getTickFrequency() / timingRuns;
+
+		int bad = countMismatches(ref, out);
+		printf("\t%-16s %8.3f ms  mismatches %d\n", balloonynessPathName(path), time, bad);
+		if (bad != 0)
+			failures++;
+	}
+	return failures;
+}
+
+int main(int argc, char **argv) {
+	int failures = 0;
+
+	//every BGR value exactly once
+	Mat all(4096, 4096, CV_8UC3);
+	for (int i = 0; i < (1 << 24); i++) {
+		Vec3b &px = all.at<Vec3b>(i >> 12, i & 4095);
+		px[0] = i & 255;
+		px[1] = (i >> 8) & 255;
+		px[2] = i >> 16;
+	}
+	failures += checkFrame("all BGR values", all);
+
+	//odd width so the scalar tail of the SIMD kernels gets used
+	failures += checkFrame("odd width crop", all(Rect(3, 0, 1277, 720)));
+
+	for (int i = 1; i < argc; i++) {
+		Mat img = imread(argv[i], CV_LOAD_IMAGE_COLOR);
+		if (!img.data) {
+			printf("could not read %s\n", argv[i]);
+			continue;
+		}
+		failures += checkFrame(argv[i], img);
+	}
+
+	if (failures != 0) {
+		printf("MISMATCH in %d kernel runs\n", failures);
+		return 1;
+	}
+	printf("all kernels bit exact\n");
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * Exactness and scaling check of the strip mined detector
+ * Description:
+ * Runs the fused kernel plus one BlobAnalyser over the whole frame, then the
+ * strip detector with different thread counts and strip heights, and checks
+ * that the mask and every blob come out the same. The test frames are noise
+ * with balloon coloured shapes that cross many strip boundaries, any extra
+ * images given on the command line are checked as well.
+ *
+ * Usage:
+ *    make testDetector
+ *    ./testDetector [image ...]
+ */
+#include "opencv2/opencv.hpp"
+#include "../common/balloonDetector.h"
+#include <stdio.h>
+
+using namespace cv;
+using namespace std;
+
+const int timingRuns = 10;
+
+bool sameBlobs(const vector<Blob> &a, const vector<Blob> &b) {
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].area != b[i].area || a[i].sumX != b[i].sumX || a[i].sumY != b[i].sumY ||
+				a[i].sumXX != b[i].sumXX || a[i].sumYY != b[i].sumYY || a[i].sumXY != b[i].sumXY ||
+				a[i].bounds() != b[i].bounds() || a[i].first != b[i].first)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * returns the number of detector configurations that did not match
+ */
+int checkFrame(const string &name, const Mat &frame) {
+	int failures = 0;
+	BalloonynessKernel kernel;
+	BlobAnalyser analyser;
+	Mat ref, mask, diff;
+	vector<Blob> refBlobs, blobs;
+	int64 t;
+
+	t = getTickCount();
+	for (int i = 0; i < timingRuns; i++) {
+		kernel.apply(frame, ref);
+		analyser.analyse(ref, refBlobs);
+	}
+	double refTime = (getTickCount() - t) * 1000. / getTickFrequency() / timingRuns;
+
+	printf("%s (%dx%d) %d blobs\n", name.c_str(), frame.cols, frame.rows, (int)refBlobs.size());
+	printf("\twhole frame           %8.3f ms\n", refTime);
+
+	const int threads[] = { 1, 2, 4, 0 };
+	const int stripRows[] = { 1, 7, 0 };
+	for (int ti = 0; ti < 4; ti++) {
+		for (int si = 0; si < 3; si++) {
+			BalloonDetector detector(BalloonynessParams(), threads[ti], stripRows[si]);
+
+			t = getTickCount();
+			for (int i = 0; i < timingRuns; i++)
+				detector.detect(frame, mask, blobs);
+			double time = (getTickCount() - t) * 1000. / getTickFrequency() / timingRuns;
+
+			compare(ref, mask, diff, CMP_NE);
+			bool ok = countNonZero(diff) == 0 && sameBlobs(refBlobs, blobs);
+			printf("\t%d threads, strip %-4d %8.3f ms  %s\n", detector.threads(), stripRows[si], time,
+					ok ? "same" : "MISMATCH");
+			if (!ok)
+				failures++;
+		}
+	}
+	return failures;
+}
+
+int main(int argc, char **argv) {
+	int failures = 0;
+
+	RNG rng(12345);
+	const Size sizes[] = { Size(640, 480), Size(1280, 720), Size(1920, 1080) };
+	for (int s = 0; s < 3; s++) {
+		Mat frame(sizes[s], CV_8UC3);
+		rng.fill(frame, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+		for (int i = 0; i < 40; i++) {
+			Point c(rng.uniform(0, frame.cols), rng.uniform(0, frame.rows));
+			Scalar colour(rng.uniform(0, 60), rng.uniform(0, 120), rng.uniform(200, 256));
+			if (i % 2)
+				circle(frame, c, rng.uniform(5, 150), colour, -1);
+			else
+				ellipse(frame, c, Size(rng.uniform(5, 200), rng.uniform(5, 60)), rng.uniform(0, 180), 0, 360, colour, 3);
+		}
+		char name[32];
+		sprintf(name, "synthetic %d", s);
+		failures += checkFrame(name, frame);
+	}
+
+	for (int i = 1; i < argc; i++) {
+		Mat img = imread(argv[i], CV_LOAD_IMAGE_COLOR);
+		if (!img.data) {
+			printf("could not read %s\n", argv[i]);
+			continue;
+		}
+		failures += checkFrame(argv[i], img);
+	}
+
+	if (failures != 0) {
+		printf("MISMATCH in %d detector runs\n", failures);
+		return 1;
+	}
+	printf("strip detector matches the whole frame path\n");
+	return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * Exactness check of the mask filters
+ * Description:
+ * Runs Morphology erode/dilate/open/close and cv::erode/cv::dilate/
+ * cv::morphologyEx with getStructuringElement(MORPH_RECT, size) on random
+ * masks and gray images and compares the results. Elements of odd and even
+ * sizes, several iterations, in place calls (src == dst), different thread
+ * counts and widths that are not a multiple of the column strip width are
+ * all covered.
+ *
+ * Then checks BlobAnalyser with a blob limit against the plain pass: under
+ * the limit it has to give the same blobs, at the limit it has to say no, and
+ * on a noise mask it has to decide from the first rows alone. U shapes, whose
+ * arms are separate labels until the row that joins them, and upside down U
+ * shapes, whose legs end on the same row, check that a blob that can still
+ * join another is never counted as finished.
+ *
+ * Usage:
+ *    make testFilter
+ *    ./testFilter
+ */
+#include "opencv2/opencv.hpp"
+#include "../common/morphology.h"
+#include "../common/blobs.h"
+#include <stdio.h>
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+enum MorphOp { OP_ERODE, OP_DILATE, OP_OPEN, OP_CLOSE };
+const char *opNames[] = { "erode", "dilate", "open", "close" };
+
+void reference(const Mat &src, Mat &dst, int op, Size element, int iterations) {
+	Mat kernel = getStructuringElement(MORPH_RECT, element);
+	if (op == OP_ERODE)
+		erode(src, dst, kernel, Point(-1, -1), iterations);
+	else if (op == OP_DILATE)
+		dilate(src, dst, kernel, Point(-1, -1), iterations);
+	else
+		morphologyEx(src, dst, op == OP_OPEN ? MORPH_OPEN : MORPH_CLOSE, kernel, Point(-1, -1), iterations);
+}
+
+void apply(Morphology &morph, const Mat &src, Mat &dst, int op, Size element, int iterations) {
+	if (op == OP_ERODE)
+		morph.erode(src, dst, element, iterations);
+	else if (op == OP_DILATE)
+		morph.dilate(src, dst, element, iterations);
+	else if (op == OP_OPEN)
+		morph.open(src, dst, element, iterations);
+	else
+		morph.close(src, dst, element, iterations);
+}
+
+bool sameImage(const Mat &a, const Mat &b) {
+	if (a.size() != b.size() || a.type() != b.type())
+		return false;
+	Mat diff;
+	compare(a, b, diff, CMP_NE);
+	return countNonZero(diff) == 0;
+}
+
+/*
+ * returns the number of element/iteration/op combinations that did not match
+ */
+int checkImage(const char *name, const Mat &src) {
+	const Size elements[] = { Size(1, 1), Size(2, 2), Size(3, 3), Size(4, 4), Size(2, 3), Size(5, 2),
+			Size(1, 7), Size(8, 1), Size(15, 15) };
+	const int nElements = sizeof(elements) / sizeof(elements[0]);
+	const int threads[] = { 1, 3, 0 };
+	int failures = 0, runs = 0;
+
+	for (int ti = 0; ti < 3; ti++) {
+		Morphology morph(threads[ti]);
+		for (int e = 0; e < nElements; e++) {
+			for (int iterations = 1; iterations <= 3; iterations++) {
+				for (int op = OP_ERODE; op <= OP_CLOSE; op++) {
+					Mat ref, dst, inPlace = src.clone();
+					reference(src, ref, op, elements[e], iterations);
+					apply(morph, src, dst, op, elements[e], iterations);
+					apply(morph, inPlace, inPlace, op, elements[e], iterations);
+					runs++;
+					if (!sameImage(ref, dst) || !sameImage(ref, inPlace)) {
+						printf("\tMISMATCH %s %dx%d x%d, %d threads%s\n", opNames[op], elements[e].width,
+								elements[e].height, iterations, morph.threads(),
+								sameImage(ref, dst) ? " (in place)" : "");
+						failures++;
+					}
+				}
+			}
+		}
+	}
+	printf("%s (%dx%d) %d runs, %s\n", name, src.cols, src.rows, runs, failures ? "MISMATCH" : "same");
+	return failures;
+}
+
+int checkMorphology(RNG &rng) {
+	int failures = 0;
+	//widths around and off the 16 column strips, heights down to a single row
+	const Size sizes[] = { Size(1, 1), Size(1, 23), Size(15, 1), Size(16, 16), Size(17, 9), Size(33, 40),
+			Size(100, 75), Size(641, 479) };
+	const int nSizes = sizeof(sizes) / sizeof(sizes[0]);
+	for (int s = 0; s < nSizes; s++) {
+		char name[48];
+		Mat gray(sizes[s], CV_8UC1);
+		rng.fill(gray, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+		sprintf(name, "gray %d", s);
+		failures += checkImage(name, gray);
+
+		//sparse binary mask, the way the detector masks look
+		Mat mask;
+		threshold(gray, mask, 200, 255, THRESH_BINARY);
+		sprintf(name, "mask %d", s);
+		failures += checkImage(name, mask);
+	}
+
+	Mat frame(480, 640, CV_8UC1), ref, dst;
+	rng.fill(frame, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+	Morphology morph;
+	const int timingRuns = 10;
+	int64 t = getTickCount();
+	for (int i = 0; i < timingRuns; i++)
+		reference(frame, ref, OP_OPEN, Size(15, 15), 1);
+	double refTime = (getTickCount() - t) * 1000. / getTickFrequency() / timingRuns;
+	t = getTickCount();
+	for (int i = 0; i < timingRuns; i++)
+		morph.open(frame, dst, Size(15, 15));
+	double time = (getTickCount() - t) * 1000. / getTickFrequency() / timingRuns;
+	printf("open 15x15 640x480: morphologyEx %8.3f ms, Morphology %8.3f ms (%d threads)\n", refTime, time,
+			morph.threads());
+	return failures;
+}
+
+bool sameBlobs(const vector<Blob> &a, const vector<Blob> &b) {
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].area != b[i].area || a[i].sumX != b[i].sumX || a[i].sumY != b[i].sumY ||
+				a[i].sumXX != b[i].sumXX || a[i].sumYY != b[i].sumYY || a[i].sumXY != b[i].sumXY ||
+				a[i].bounds() != b[i].bounds() || a[i].first != b[i].first)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * count is the number of blobs in mask. Just above it the limited pass must
+ * match the plain one, at it and below it must give up with no blobs
+ */
+int checkLimit(const char *name, const Mat &mask, const vector<Blob> &ref) {
+	BlobAnalyser analyser;
+	vector<Blob> blobs;
+	int count = (int)ref.size(), failures = 0;
+
+	bool ok = analyser.analyse(mask, blobs, count + 1) && sameBlobs(ref, blobs);
+	for (int limit = max(count - 2, 1); limit <= count; limit++)
+		ok = ok && !analyser.analyse(mask, blobs, limit) && blobs.empty();
+	if (!ok)
+		failures++;
+	printf("%s (%dx%d) %d blobs, limit %s\n", name, mask.cols, mask.rows, count, ok ? "same" : "MISMATCH");
+	return failures;
+}
+
+//U shape (arms joined by the bottom bar) and upside down U (legs hanging from the top bar)
+void drawU(Mat &mask, Point corner, Size size, int thickness, bool upsideDown) {
+	int barY = upsideDown ? corner.y : corner.y + size.height - thickness;
+	mask(Rect(corner.x, corner.y, thickness, size.height)).setTo(Scalar(255));
+	mask(Rect(corner.x + size.width - thickness, corner.y, thickness, size.height)).setTo(Scalar(255));
+	mask(Rect(corner.x, barY, size.width, thickness)).setTo(Scalar(255));
+}
+
+int checkBlobLimit(RNG &rng) {
+	int failures = 0;
+	BlobAnalyser analyser;
+	vector<Blob> ref, blobs;
+
+	//rows of U and upside down U shapes of different sizes and thicknesses
+	Mat shapes(160, 641, CV_8UC1, Scalar(0));
+	for (int i = 0; i < 20; i++) {
+		Point corner(2 + i * 32, 4 + (i % 3) * 40);
+		drawU(shapes, corner, Size(8 + i % 20, 30 - (i % 4)), 1 + i % 3, i % 2 != 0);
+	}
+	//U and W shapes whose arms start on different rows and only meet in the bottom bar
+	for (int i = 0; i < 10; i++) {
+		int x = 4 + i * 60, y = 124;
+		shapes(Rect(x, y + i % 5, 2, 30 - i % 5)).setTo(Scalar(255));
+		shapes(Rect(x + 18, y + 3 * (i % 4), 2, 30 - 3 * (i % 4))).setTo(Scalar(255));
+		if (i % 2)
+			shapes(Rect(x + 9, y + 7 * (i % 3), 2, 30 - 7 * (i % 3))).setTo(Scalar(255));
+		shapes(Rect(x, y + 28, 20, 2)).setTo(Scalar(255));
+	}
+	analyser.analyse(shapes, ref);
+	failures += checkLimit("U shapes", shapes, ref);
+
+	//random masks of every density, from a few blobs to a lot of late merges
+	const Size sizes[] = { Size(17, 9), Size(100, 75), Size(641, 479) };
+	for (int s = 0; s < 3; s++) {
+		for (int density = 5; density <= 60; density += 11) {
+			Mat gray(sizes[s], CV_8UC1), mask;
+			rng.fill(gray, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+			threshold(gray, mask, 255 - density * 255 / 100, 255, THRESH_BINARY);
+			analyser.analyse(mask, ref);
+			char name[48];
+			sprintf(name, "noise %d%%", density);
+			failures += checkLimit(name, mask, ref);
+		}
+	}
+
+	//a noise mask has to be decided from its first rows, the rest is never needed
+	Mat gray(1080, 1920, CV_8UC1), noise;
+	rng.fill(gray, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+	threshold(gray, noise, 200, 255, THRESH_BINARY);
+	const int limit = 50;
+	analyser.analyse(noise, ref);
+	vector<int> ends;
+	for (size_t i = 0; i < ref.size(); i++)
+		ends.push_back(ref[i].maxY);
+	sort(ends.begin(), ends.end());
+	//the limit'th blob to end is known to be finished once the row below it is labelled
+	int rows = min(noise.rows, ends[limit - 1] + 2);
+	bool ok = !analyser.analyse(noise.rowRange(0, rows), blobs, limit) && blobs.empty();
+
+	const int timingRuns = 10;
+	int64 t = getTickCount();
+	for (int i = 0; i < timingRuns; i++)
+		analyser.analyse(noise, ref);
+	double refTime = (getTickCount() - t) * 1000. / getTickFrequency() / timingRuns;
+	t = getTickCount();
+	for (int i = 0; i < timingRuns; i++)
+		ok = !analyser.analyse(noise, blobs, limit) && blobs.empty() && ok;
+	double time = (getTickCount() - t) * 1000. / getTickFrequency() / timingRuns;
+	printf("noise 1920x1080, limit %d decided in %d rows: plain %8.3f ms, limited %8.3f ms  %s\n", limit, rows,
+			refTime, time, ok ? "same" : "MISMATCH");
+	if (!ok)
+		failures++;
+	return failures;
+}
+
+int main() {
+	int failures = 0;
+	RNG rng(12345);
+
+	failures += checkMorphology(rng);
+	failures += checkBlobLimit(rng);
+
+	if (failures != 0) {
+		printf("MISMATCH in %d filter runs\n", failures);
+		return 1;
+	}
+	printf("filters match the OpenCV results\n");
+	return 0;
+}
@@ -2,6 +2,7 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/gpu/gpu.hpp>
+#include "../common/colorLUT.h"
 
 #include <iostream>
 #include <stdio.h>
@@ -25,6 +26,9 @@ int hue_min = 0, sat_min = 0, val_min = 0;
 int hue_max = 180, sat_max = 255, val_max = 255;
 SimpleBlobDetector::Params params;
 std::string trackbar_window = "hsv trackbars";
+ColorLUT hsvTable; //classifies pixels against the hsv range below
+int hsvTarget = -1;
+bool hsvChanged = true; //set by the trackbars so the table is only rebuilt when the range moves
 //capture = cvCaptureFromCAM( CV_CAP_ANY ); //0=default, -1=any camera, 1..99=your camera
 
 
@@ -81,7 +85,7 @@ void getFiles(std::string filename, VideoCapture dest)
 
 void hsvOnChange(int val, void *data)
 {
-
+	hsvChanged = true;
 }
 
 void hsv_gui_init()
@@ -116,35 +120,28 @@ void redChannelSplit(Mat frame)
 
 /*
   Note:
-  seems like inRange only takes in Mat parameters, not GpuMat
+  the hsv range check is done with a colour lookup table, so there is no
+  per pixel hsv conversion. The table is rebuilt when a trackbar moves.
  */
 
 void renderHSV(Mat frame)
 {
-	//Mat -> GpuMat
-    GpuMat GpuHue(frame);
-	//RGB -> HSV
-	GpuMat convertedHue;
-	gpu::cvtColor(GpuHue, convertedHue, CV_RGB2HSV);
+	if (hsvTarget < 0) {
+		hsvTarget = hsvTable.addRange("red", Scalar(0, 0, 0), Scalar(255, 100, 100), CV_RGB2HSV);
+	}
+#ifdef ENABLE_HSV_GUI
+	if (hsvChanged) {
+		hsvTable.setRange(hsvTarget, Scalar(hue_min, sat_min, val_min), Scalar(hue_max, sat_max, val_max));
+	}
+#endif
+	if (hsvChanged) {
+		hsvTable.build();
+		hsvChanged = false;
+	}
 
 	//Filter red
 	Mat redHueFrame;
-#ifdef ENABLE_HSV_GUI
-	//********PROBLEM: can't use inRange because not rgb anymore?********//
-	Mat low_bound;
-	low_bound = cv::Scalar(0,0,0);
-	Mat up_bound;
-	up_bound = cv::Scalar(255,100,100);
-	GpuMat g_low(low_bound);
-	GpuMat g_up(up_bound);
-	Mat tmp;
-	convertedHue.download(tmp);
-	inRange(tmp, Scalar(hue_min,sat_min,val_min), Scalar(hue_max,sat_max,val_max), redHueFrame);
-#else
-	//hard coded lower and upper bound for red
-	inRange(convertedHue, Scalar(0, 0, 0), Scalar(255, 100, 100), redHueFrame);
-#endif
-	//convertedHue.download(hsvFrame);
+	hsvTable.mask(frame, hsvTarget, redHueFrame);
 	hsvFrame = redHueFrame;
 }
 
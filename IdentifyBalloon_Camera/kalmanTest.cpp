@@ -0,0 +1,130 @@
+/*
+ * Prediction check of the fixed size Kalman filters
+ * Description:
+ * Feeds ConstantVelocityKalman the exact positions of a target moving at
+ * constant velocity with uneven frame intervals, a dropped frame and a longer
+ * gap, and checks every prediction lands on the target once the filter has
+ * settled. A filter that stepped one frame's worth whatever the interval
+ * would miss by the distance covered in the lost time. Then checks that
+ * ConstantAccelerationKalman converges on an accelerating target, position
+ * and velocity both, where the constant velocity filter keeps lagging.
+ *
+ * Usage:
+ *    make testKalman
+ *    ./testKalman
+ */
+#include "opencv2/opencv.hpp"
+#include "../common/kalman.h"
+#include <stdio.h>
+
+using namespace cv;
+using namespace std;
+
+const int settleFrames = 30;
+const float maxPositionError = 0.5f; //px
+const float maxVelocityError = 1.f;  //px/s
+
+float pointDistance(Point2f a, Point2f b) {
+	Point2f d = a - b;
+	return sqrtf(d.x * d.x + d.y * d.y);
+}
+
+/*
+ * returns the number of checks that failed
+ */
+int checkConstantVelocity() {
+	const Point2f start(100, 200), v(120, -45);
+	ConstantVelocityKalman kal;
+	kal.init(start, 100, 4, 1e4);
+
+	int failures = 0;
+	float t = 0, worst = 0;
+	for (int frame = 1; frame <= 90; frame++) {
+		//30 fps with a little jitter, a dropped frame and a three frame gap
+		float dt = (1 + 0.1f * ((frame * 7) % 5 - 2)) / 30;
+		if (frame == 60)
+			dt = 2.f / 30;
+		if (frame == 75)
+			dt = 4.f / 30;
+		t += dt;
+		Point2f truth = start + v * t;
+
+		float sigmaBefore = kal.positionSigma();
+		kal.predict(dt);
+		float error = pointDistance(kal.position(), truth);
+		if (frame > settleFrames) {
+			worst = max(worst, error);
+			if (error > maxPositionError) {
+				printf("\tframe %d (dt %.3f s) predicted %.2f px off\n", frame, dt, error);
+				failures++;
+			}
+		}
+		//the gap has to widen the search area, not just move it
+		if ((frame == 60 || frame == 75) && kal.positionSigma() <= sigmaBefore) {
+			printf("\tframe %d: sigma did not grow across the gap (%.3f -> %.3f px)\n", frame, sigmaBefore,
+					kal.positionSigma());
+			failures++;
+		}
+		kal.correct(truth);
+	}
+
+	//a repeated frame leaves the state where it is
+	Point2f before = kal.position();
+	kal.predict(0);
+	if (pointDistance(kal.position(), before) != 0) {
+		printf("\tdt 0 moved the state\n");
+		failures++;
+	}
+
+	float vError = pointDistance(kal.velocity(), v);
+	if (vError > maxVelocityError)
+		failures++;
+	printf("constant velocity: worst prediction %.3f px, velocity off by %.3f px/s  %s\n", worst, vError,
+			failures ? "MISMATCH" : "ok");
+	return failures;
+}
+
+int checkConstantAcceleration() {
+	const Point2f start(320, 240), v0(-20, 10), a(60, 30);
+	ConstantAccelerationKalman kal;
+	ConstantVelocityKalman lagging;
+	kal.init(start, 1000, 4, 1e4);
+	lagging.init(start, 1000, 4, 1e4);
+
+	int failures = 0;
+	float t = 0, worst = 0, laggingWorst = 0;
+	const float dt = 1.f / 30;
+	for (int frame = 1; frame <= 90; frame++) {
+		t += dt;
+		Point2f truth = start + v0 * t + a * (0.5f * t * t);
+		kal.predict(dt);
+		lagging.predict(dt);
+		if (frame > settleFrames) {
+			worst = max(worst, pointDistance(kal.position(), truth));
+			laggingWorst = max(laggingWorst, pointDistance(lagging.position(), truth));
+		}
+		kal.correct(truth);
+		lagging.correct(truth);
+	}
+
+	float vError = pointDistance(kal.velocity(), v0 + a * t);
+	if (worst > maxPositionError || vError > maxVelocityError)
+		failures++;
+	printf("constant acceleration: worst prediction %.3f px (constant velocity %.3f px), velocity off by %.3f px/s  %s\n",
+			worst, laggingWorst, vError, failures ? "MISMATCH" : "ok");
+	return failures;
+}
+
+int main() {
+	int failures = 0;
+
+	failures += checkConstantVelocity();
+	failures += checkConstantAcceleration();
+
+	if (failures != 0) {
+		printf("MISMATCH in %d kalman checks\n", failures);
+		return 1;
+	}
+	printf("kalman filters follow their targets\n");
+	return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Camera recorder
+ * Description:
+ * Saves what the camera delivers, losslessly and with the capture times, to
+ * a recording the programs can replay with --input (see
+ * common/frameRecorder.h). Nothing else runs, so the recording has every
+ * frame the camera gave. It can also turn a video file into a recording.
+ *
+ * Usage:
+ *    make record
+ *    ./record OUT.rec [frames] [WxH] [--input SPEC] [--no-v4l2]
+ * frames defaults to 0, record until ctrl-C. WxH is what the camera is
+ * asked for, 1280x720 (FEED_SIZE 3) by default.
+ */
+#include "opencv2/opencv.hpp"
+#include "../common/frameInput.h"
+#include "../common/latency.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+volatile sig_atomic_t running = 1;
+
+extern "C" void quit_signal_handler(int /*signum*/) {
+	running = 0;
+}
+
+int main(int argc, char **argv) {
+	FrameInputOptions options;
+	vector<string> args;
+	if (!parseFrameInputOptions(argc, argv, options, args) || args.empty() || !options.recordPath.empty()) {
+		fprintf(stderr, "usage: %s OUT.rec [frames] [WxH] [--input SPEC] [--no-v4l2]\n", argv[0]);
+		return 1;
+	}
+	options.recordPath = args[0];
+	int maxFrames = args.size() > 1 ? atoi(args[1].c_str()) : 0;
+	Size size(1280, 720);
+	if (args.size() > 2 && sscanf(args[2].c_str(), "%dx%d", &size.width, &size.height) != 2) {
+		fprintf(stderr, "bad size %s\n", args[2].c_str());
+		return 1;
+	}
+
+	FrameInput camera;
+	if (!camera.open(options, size)) {
+		return 1;
+	}
+	fprintf(stderr, "recording %dx%d from %s to %s, ctrl-C stops\n", camera.size().width,
+			camera.size().height, camera.name(), options.recordPath.c_str());
+	signal(SIGINT, quit_signal_handler);
+
+	FrameView frame;
+	int64 stamp, first = 0, last = 0;
+	vector<int64> gaps;
+	while (running && (maxFrames <= 0 || camera.recorded() < maxFrames)) {
+		int before = camera.recorded();
+		if (!camera.read(frame, stamp) || camera.recorded() == before) {
+			break;
+		}
+		frame.release();
+		if (before == 0) {
+			first = stamp;
+		} else {
+			gaps.push_back(stamp - last);
+		}
+		last = stamp;
+	}
+
+	int n = camera.recorded();
+	double seconds = (last - first) / 1000000.0;
+	printf("%d frames over %.2f s (%.2f fps)\n", n, seconds, seconds > 0 ? (n - 1) / seconds : 0.0);
+	if (!gaps.empty()) {
+		sort(gaps.begin(), gaps.end());
+		int64 median = gaps[gaps.size() / 2];
+		//anything much longer than the usual frame time is a frame the camera or the disk lost
+		int longGaps = int(gaps.end() - upper_bound(gaps.begin(), gaps.end(), median * 3 / 2));
+		printf("frame time median %.2f ms, max %.2f ms, %d gaps over 1.5x the median\n",
+				median / 1000.0, gaps.back() / 1000.0, longGaps);
+	}
+	return 0;
+}
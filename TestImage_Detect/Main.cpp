@@ -1,6 +1,5 @@
 #include "opencv2/opencv.hpp"
 #include "opencv2/gpu/gpu.hpp"
-#include <sys/time.h>
 #include <cstdio>
 #include <cmath>
 #include <cstdarg>
@@ -8,114 +7,128 @@
 #include <stdio.h>
 #include <iostream>
 #include <dirent.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include "../common/balloonDetector.h"
+#include "../common/threadPool.h"
+#include "../common/runOptions.h"
+#include "../common/detectionLog.h"
+#include "../common/batchResults.h"
+#include "../common/frameCache.h"
+#include "../common/latency.h"
+#include "../common/overlayWriter.h"
 
 
 using namespace cv;
 using namespace std;
 
-#define PER_FRAME_TIME_LOGGING 1
-#define SHOW_FEED_WINDOW 1
-#define SHOW_OTHER_WINDOWS 0
-#define SHOW_OUTPUT_WINDOW 1
-#define DRAW_DEBUG_DATA 1
+#define USE_GPU 0 //1 runs the colour chain on the cuda device, 0 uses the cpu strip detector
 
-double avgCaptureTime = 0,
-		avgConversionTime = 0,
-		avgSplitTime = 0,
-		avgProcessingTime = 0,
-		avgDisplayTime = 0;
+//per stage latency histograms, see common/latency.h
+LatencyStage loadLatency("image load"),
+		conversionLatency("color conversion"),
+		splitLatency("split planes"),
+		processingLatency("frame processing"),
+		overlayLatency("overlay drawing"),
+		writeLatency("overlay write"),
+		displayLatency("display");
 
-long captureTime = 0,
-		conversionTime = 0,
-		splitTime = 0,
-		processingTime = 0,
-		displayTime = 0;
-
-int nFrames = 0;
+//windows, drawing and logging are chosen on the command line, see common/runOptions.h
+RunOptions opts;
+DetectionLog detectionLog;
+FILE *statusOut = stdout; //stderr when the detections go to stdout
 
 const double areaRatio = 0.65;
-const string file_in_path = "/home/ubuntu/Aerial/photos";
-const string file_out_path = "/home/ubuntu/Aerial/outPhotos";
-void initGUI() {
-#if (SHOW_FEED_WINDOW == 1)
-	namedWindow("feed");
-#endif
-#if (SHOW_OTHER_WINDOWS == 1)
-	namedWindow("hue");
-	namedWindow("sat");
-	namedWindow("val");
-	namedWindow("balloonyness");
-#endif
-#if (SHOW_OUTPUT_WINDOW == 1)
-	namedWindow("debugOverlay");
-#endif
-}
-
-void recordTime(long delta, double *avgTime) {
-	*avgTime = (*avgTime * nFrames + delta) / (nFrames + 1);
-}
+//used when no input paths or --out are given
+const string default_in_path = "/home/ubuntu/Aerial/photos";
+const string default_out_path = "/home/ubuntu/Aerial/outPhotos";
+string file_out_path;
+std::atomic<int> nEvaluated(0);
+std::atomic<int> nFrameCacheHits(0), nResultCacheHits(0);
+
+//both disabled unless --cache is given, see common/frameCache.h
+FrameCache frameCache;
+ResultCache resultCache;
+//saves the overlays off the workers, only there with --write-overlay
+OverlayWriter *overlayWriter = NULL;
+
+/*
+ * everything working on one image needs. Batch runs have one per worker,
+ * each with a single threaded detector since the images are the parallel part
+ */
+struct ImageWork {
+	BalloonDetector *detector;
+	FrameView cachedFrame; //keeps the mapping under frame_host when it came from the cache
+	Mat frame_host, thresh_host, balloonyness_host, debugOverlay;
+	Overlay overlay;
+	gpu::GpuMat frame, hue, sat, val, balloonyness;
+	vector< Blob > blobs;
+};
 
-long getTimeDelta(struct timeval timea, struct timeval timeb) {
-	return 1000000 * (timeb.tv_sec - timea.tv_sec) +
-			(int(timeb.tv_usec) - int(timea.tv_usec));
+void initGUI() {
+	if (opts.showFeed) {
+		namedWindow("feed");
+	}
+	if (opts.showOther) {
+		namedWindow("hue");
+		namedWindow("sat");
+		namedWindow("val");
+		namedWindow("balloonyness");
+	}
+	if (opts.showOutput) {
+		namedWindow("debugOverlay");
+	}
 }
 
 void log(const char* msg, ...) {
-#if (PER_FRAME_TIME_LOGGING == 1)
+	if (!opts.logTimes) {
+		return;
+	}
 	va_list args;
 	va_start(args, msg);
-	printf(msg, args);
-#endif
+	vfprintf(statusOut, msg, args);
+	va_end(args);
 }
 
-void captureFrame(string file, Mat &frame_host, gpu::GpuMat &frame, Mat &debugOverlay) {
-	string filepath = file_in_path + "/" + file;
+bool captureFrame(const string &filepath, Mat &frame_host) {
 	frame_host = imread(filepath, CV_LOAD_IMAGE_COLOR);   // Read the file
 	if(! frame_host.data )                              // Check for invalid input
 	{
-		cout <<  "Could not open or find the image" << endl << file << endl;
-		return;
+		fprintf(statusOut, "Could not open or find the image\n%s\n", filepath.c_str());
+		return false;
 	}
-
-	debugOverlay = frame_host.clone();
-	frame.upload(frame_host);
+	return true;
 }
 
 void convertToHSV(gpu::GpuMat &frame, gpu::GpuMat &hue, gpu::GpuMat &sat, gpu::GpuMat &val) {
-	struct timeval timea, timeb;
 	gpu::GpuMat hsv;
 	vector<gpu::GpuMat> hsvplanes(3);
 	hsvplanes[0] = hue;
 	hsvplanes[1] = sat;
 	hsvplanes[2] = val;
 
-	gettimeofday(&timea, NULL);
-	cout << "pre convert" << endl;
+	ScopedLatency conversionTimer(conversionLatency);
 	gpu::cvtColor(frame, hsv, CV_BGR2HSV);
-	cout << "converted" << endl;
-	gettimeofday(&timeb, NULL);
-
-	conversionTime = getTimeDelta(timea, timeb);
-	log("color conversion time used:\t%ld\n", conversionTime);
+	log("color conversion time used:\t%ld\n", conversionTimer.stop());
 
-	gettimeofday(&timea, NULL);
+	ScopedLatency splitTimer(splitLatency);
 	gpu::split(hsv, hsvplanes);
 	hue = hsvplanes[0];
 	sat = hsvplanes[1];
 	val = hsvplanes[2];
-	gettimeofday(&timeb, NULL);
-
-	splitTime = getTimeDelta(timea, timeb);
-	log("split planes time used:   \t%ld\n", splitTime);
+	log("split planes time used:   \t%ld\n", splitTimer.stop());
 }
 
-void processFrame(gpu::GpuMat &hue, gpu::GpuMat &sat, gpu::GpuMat &balloonyness, Mat &debugOverlay) {
-	struct timeval timea, timeb;
+/*
+ * gpu colour chain and blob search, the blobs are the candidates
+ */
+void processFrame(gpu::GpuMat &hue, gpu::GpuMat &sat, gpu::GpuMat &balloonyness, vector< Blob > &blobs) {
+	ScopedLatency timer(processingLatency);
 	gpu::GpuMat huered, scalehuered, scalesat, thresh;
 	Mat thresh_host;
-	vector< vector< Point > > contours;
-
-	gettimeofday(&timea, NULL);
+	BlobAnalyser analyser;
 
 	gpu::absdiff(hue, Scalar(90), huered);
 	gpu::divide(huered, Scalar(4), scalehuered);
@@ -124,122 +137,334 @@ void processFrame(gpu::GpuMat &hue, gpu::GpuMat &sat, gpu::GpuMat &balloonyness,
 	gpu::threshold(balloonyness, thresh, 200, 255, THRESH_BINARY);
 	thresh.download(thresh_host);
 
-	findContours(thresh_host, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE);
+	analyser.analyse(thresh_host, blobs);
 
-#if (DRAW_DEBUG_DATA == 1)
-	drawContours(debugOverlay, contours, -1, Scalar(255, 0, 0));
-#endif
+	log("frame processing time used:\t%ld\n", timer.stop());
+}
 
-	vector< Point2f > circleCenters(contours.size());
-	vector< float > circleRadii(contours.size());
-	Point2f center;
-	float radius;
-	for (int n = 0; n < contours.size(); ++n) {
-		minEnclosingCircle(contours[n], center, radius);
+/*
+ * cpu version of convertToHSV and processFrame, see common/balloonDetector.h
+ */
+void computeCandidates(BalloonDetector &detector, const Mat &frame_host, Mat &thresh_host, vector< Blob > &blobs) {
+	ScopedLatency timer(processingLatency);
+	detector.detect(frame_host, thresh_host, blobs);
+	log("strip detector time used:\t%ld\n", timer.stop());
+}
 
-#if (DRAW_DEBUG_DATA == 1)
-		circle(debugOverlay, center, radius, Scalar(0, 255, 255));
-#endif
+/*
+ * what gets drawn for the candidate blobs, the round ones in green with
+ * their roundness next to them
+ */
+void drawBalloons(const vector< Blob > &blobs, Overlay &overlay) {
+	overlay.clear();
+	for (int n = 0; n < blobs.size(); ++n) {
+		Point2f center = blobs[n].centroid();
+		float radius = blobs[n].radius();
+
+		if (opts.drawDebug) {
+			overlay.addRect(blobs[n].bounds(), Scalar(255, 0, 0));
+			overlay.addCircle(center, radius, Scalar(0, 255, 255));
+		}
 
-		if (contourArea(contours[n]) >= areaRatio * radius*radius*3.1415926) {
-			circle(debugOverlay, center, radius, Scalar(0, 255, 0), 2);
+		if (blobs[n].roundness() >= areaRatio) {
+			char label[32];
+			sprintf(label, "%.2f", blobs[n].roundness());
+			overlay.addCircle(center, radius, Scalar(0, 255, 0), 2);
+			overlay.addLabel(center + Point2f(radius + 4, 0), label, Scalar(0, 255, 0));
 		}
 	}
-
-	gettimeofday(&timeb, NULL);
-	processingTime = getTimeDelta(timea, timeb);
-	log("frame processing time used:\t%ld\n", processingTime);
 }
 
-void displayOutput(Mat frame, gpu::GpuMat hue, gpu::GpuMat sat, gpu::GpuMat val, gpu::GpuMat balloonyness, Mat debugOverlay) {
-	struct timeval timea, timeb;
+void displayOutput(Mat frame, gpu::GpuMat hue, gpu::GpuMat sat, gpu::GpuMat val, Mat balloonyness, Mat debugOverlay) {
+	ScopedLatency timer(displayLatency);
 
-	gettimeofday(&timea, NULL);
-
-#if (SHOW_FEED_WINDOW == 1)
-	imshow("feed", frame);
-#endif
-#if (SHOW_OTHER_WINDOWS ==1)
-	Mat hue_host, sat_host, val_host, balloonyness_host;
-	hue.download(hue_host);
-	sat.download(sat_host);
-	val.download(val_host);
-	balloonyness.download(balloonyness_host);
-	imshow("hue", hue_host);
-	imshow("sat", sat_host);
-	imshow("val", val_host);
-	imshow("balloonyness", balloonyness_host);
-#endif
-#if (SHOW_OUTPUT_WINDOW == 1)
-	imshow("debugOverlay", debugOverlay);
+	if (opts.showFeed) {
+		imshow("feed", frame);
+	}
+	if (opts.showOther) {
+#if (USE_GPU == 1)
+		Mat hue_host, sat_host, val_host;
+		hue.download(hue_host);
+		sat.download(sat_host);
+		val.download(val_host);
+		imshow("hue", hue_host);
+		imshow("sat", sat_host);
+		imshow("val", val_host);
 #endif
+		imshow("balloonyness", balloonyness);
+	}
+	if (opts.showOutput) {
+		imshow("debugOverlay", debugOverlay);
+	}
 
-	gettimeofday(&timeb, NULL);
-	displayTime = getTimeDelta(timea, timeb);
-	log("display frame time used:\t%ld\n", displayTime);
+	log("display frame time used:\t%ld\n", timer.stop());
 }
 bool has_suffix(const string& s, const string& suffix)
 {
 	return (s.size() >= suffix.size()) && equal(suffix.rbegin(), suffix.rend(), s.rbegin());
 }
-vector<string> get_images(){
+bool is_image(const string &name)
+{
+	return has_suffix(name, ".jpg") || has_suffix(name, ".jpeg") || has_suffix(name, ".png") ||
+			has_suffix(name, ".JPG") || has_suffix(name, ".PNG");
+}
+/*
+ * every image in the given directories plus the image files given directly,
+ * each directory sorted by name so runs are in the same order every time
+ */
+vector<string> get_images(const vector<string> &paths){
 	vector<string> imgs;
-	string ext = ".jpg";
-	DIR *dir = opendir(file_in_path.c_str());
-	dirent *entry;
-	if (!dir) {
-	    perror("opendir");
-	    exit(1);
-	}
+	for (size_t i = 0; i < paths.size(); i++) {
+		struct stat info;
+		if (stat(paths[i].c_str(), &info) != 0) {
+			perror(paths[i].c_str());
+			continue;
+		}
+		if (!S_ISDIR(info.st_mode)) {
+			imgs.push_back(paths[i]);
+			continue;
+		}
 
-	while ( (entry = readdir(dir)) != NULL) {
-	    if(has_suffix(entry->d_name, ext))
-		{
-	    	cout << entry->d_name << endl;
-	    	string filepath = entry->d_name;
-	    	imgs.push_back(filepath);
+		DIR *dir = opendir(paths[i].c_str());
+		if (!dir) {
+			perror(paths[i].c_str());
+			continue;
+		}
+		vector<string> names;
+		dirent *entry;
+		while ( (entry = readdir(dir)) != NULL) {
+			if (is_image(entry->d_name)) {
+				names.push_back(entry->d_name);
+			}
+		}
+		closedir(dir);
+		sort(names.begin(), names.end());
+		for (size_t j = 0; j < names.size(); j++) {
+			imgs.push_back(paths[i] + "/" + names[j]);
 		}
 	}
-	closedir(dir);
 	return(imgs);
 }
-bool write_image(Mat frame, string file){
+/*
+ * where the overlay of file is saved
+ */
+string out_path(const string &file){
+	size_t slash = file.rfind('/');
+	return file_out_path + "/" + (slash == string::npos ? file : file.substr(slash + 1));
+}
+/*
+ * the overlay names its frame, it has to be found again from wherever it is rendered
+ */
+string absolute_path(const string &file){
+	char *resolved = realpath(file.c_str(), NULL);
+	if (!resolved) {
+		return file;
+	}
+	string path(resolved);
+	free(resolved);
+	return path;
+}
 
-	vector<int> compression_params;
-	compression_params.push_back(CV_IMWRITE_JPEG_QUALITY);
-	compression_params.push_back(100);
-	string filepath = file_out_path + "/" + file;
-	imwrite(filepath, frame, compression_params);
+/*
+ * load, detect, draw and save one image, filling in its row of the results
+ */
+bool evaluateImage(ImageWork &work, const string &file, ImageResult &result) {
+	result.path = file;
+	//nothing to draw and nothing changed since the last run: nothing to do
+	if (!opts.needOverlay() && resultCache.load(file, result.size, result.candidates, result.detections)) {
+		result.loaded = result.cached = true;
+		++nResultCacheHits;
+		return true;
+	}
+
+	ScopedLatency loadTimer(loadLatency);
+	bool loaded;
+	if (frameCache.load(file, work.cachedFrame)) {
+		work.frame_host = work.cachedFrame.image();
+		++nFrameCacheHits;
+		loaded = true;
+	} else {
+		work.cachedFrame.release();
+		loaded = captureFrame(file, work.frame_host);
+		if (loaded) {
+			frameCache.store(file, work.frame_host);
+		}
+	}
+	result.loadUs = loadTimer.stop();
+	if (!loaded) {
+		return false;
+	}
+	result.loaded = true;
+	result.size = work.frame_host.size();
+
+	int64 start = monotonicMicros();
+#if (USE_GPU == 1)
+	work.frame.upload(work.frame_host);
+	convertToHSV(work.frame, work.hue, work.sat, work.val);
+	processFrame(work.hue, work.sat, work.balloonyness, work.blobs);
+	if (opts.showOther) {
+		work.balloonyness.download(work.balloonyness_host);
+	}
+#else
+	computeCandidates(*work.detector, work.frame_host, work.thresh_host, work.blobs);
+	work.balloonyness_host = work.thresh_host;
+#endif
+	result.stamp = monotonicMicros();
+	result.detectUs = long(result.stamp - start);
+	result.candidates = (int)work.blobs.size();
+	blobsToDetections(work.blobs, areaRatio, result.detections);
+	resultCache.store(file, result.size, result.candidates, result.detections);
+
+	//headless runs stop here, nothing is copied or drawn. A compact overlay
+	//that nobody looks at is never rendered either
+	if (opts.needOverlay()) {
+		ScopedLatency timer(overlayLatency);
+		drawBalloons(work.blobs, work.overlay);
+		if (opts.showOutput || !opts.compactOverlay) {
+			work.debugOverlay = work.frame_host.clone();
+			work.overlay.render(work.debugOverlay);
+		}
+		result.overlayUs = timer.stop();
+	}
+	//the writer encodes on its own threads, this only waits when its queue is full
+	if (opts.writeOverlay) {
+		ScopedLatency timer(writeLatency);
+		if (opts.compactOverlay) {
+			work.overlay.source = absolute_path(file);
+			work.overlay.size = result.size;
+			overlayWriter->submitOverlay(out_path(file) + ".overlay", work.overlay);
+		} else {
+			//a fresh clone every image, the writer keeps this one until it is saved
+			overlayWriter->submitImage(out_path(file), work.debugOverlay);
+		}
+		result.writeUs = timer.stop();
+	}
+
+	int n = ++nEvaluated;
+	if (opts.statsInterval > 0 && n % opts.statsInterval == 0) {
+		dumpLatencyStats(statusOut);
+	}
 	return true;
 }
-int main() {
 
-	struct timeval timea, timeb, startTime, endTime;
-	gettimeofday(&startTime, NULL);
+int main(int argc, char **argv) {
+	//defaults of this program, the switches in common/runOptions.h change them
+	opts.showFeed = true;
+	opts.writeOverlay = true;
+	opts.logTimes = true;
+	vector<string> args;
+	if (!parseRunOptions(argc, argv, opts, args)) {
+		return(1);
+	}
+	if (opts.detectionsPath == "-" || opts.resultsPath == "-") {
+		statusOut = stderr;
+	}
+	if (!opts.detectionsPath.empty() && !detectionLog.open(opts.detectionsPath, opts.detectionsFormat)) {
+		return(1);
+	}
+	if (args.empty()) {
+		args.push_back(default_in_path);
+	}
+	file_out_path = opts.outputDir.empty() ? default_out_path : opts.outputDir;
+	if (!opts.cacheDir.empty()) {
+		mkdir(opts.cacheDir.c_str(), 0755);
+		frameCache = FrameCache(opts.cacheDir);
+		resultCache = ResultCache(opts.cacheDir, hashDetectorParams(BalloonynessParams(), areaRatio));
+	}
 
-	Mat frame_host, thresh_host, debugOverlay;
-	gpu::GpuMat frame, hsv, hue, sat, val, huered, scalehuered, scalesat, balloonyness, thresh;
+	int64 startTime = monotonicMicros();
 
-	vector<string> images = get_images();
+	//saved compact overlays given as inputs are only rendered, not detected on
+	vector<string> images;
+	vector<string> found = get_images(args);
+	for (size_t i = 0; i < found.size(); i++) {
+		if (!has_suffix(found[i], ".overlay")) {
+			images.push_back(found[i]);
+		} else if (!renderOverlayFile(found[i], out_path(found[i].substr(0, found[i].size() - 8)))) {
+			fprintf(statusOut, "Could not render %s\n", found[i].c_str());
+		}
+	}
+	vector<ImageResult> results(images.size());
+	if (opts.writeOverlay && !images.empty()) {
+		overlayWriter = new OverlayWriter();
+	}
 
 	log("optimized code: %d\n", useOptimized());
 	log("cuda devices: %d\n", gpu::getCudaEnabledDeviceCount());
 	log("current device: %d\n", gpu::getDevice());
 
-	initGUI();
-	log("starting balloon recognition\n");
+	if (opts.anyWindow()) {
+		//one image at a time on the main thread, highgui wants imshow and waitKey there
+		initGUI();
+		log("starting balloon recognition\n");
+		ImageWork work;
+		work.detector = new BalloonDetector(BalloonynessParams(), opts.jobs);
+		for (size_t i = 0; i < images.size(); i++) {
+			fprintf(statusOut, "Checking file %s\n", images[i].c_str());
+			if (!evaluateImage(work, images[i], results[i])) {
+				continue;
+			}
+			displayOutput(work.frame_host, work.hue, work.sat, work.val, work.balloonyness_host, work.debugOverlay);
+			waitKey(0);
+		}
+		delete work.detector;
+	} else {
+		//headless batch: the images are spread over the workers, each runs its images start to end
+#if (USE_GPU == 1)
+		ThreadPool pool(1); //one cuda context, one image at a time
+#else
+		ThreadPool pool(opts.jobs);
+#endif
+		vector< ImageWork > work(pool.size());
+		for (size_t w = 0; w < work.size(); w++) {
+			work[w].detector = new BalloonDetector(BalloonynessParams(), 1);
+		}
+		log("starting balloon recognition on %d images with %d workers\n", (int)images.size(), pool.size());
+		std::atomic<int> next(0);
+		pool.parallelFor(pool.size(), [&](int w) {
+			for (int i = next++; i < (int)images.size(); i = next++) {
+				log("Checking file %s\n", images[i].c_str());
+				evaluateImage(work[w], images[i], results[i]);
+			}
+		});
+		for (size_t w = 0; w < work.size(); w++) {
+			delete work[w].detector;
+		}
+	}
+
+	//everything saved before the totals are taken
+	if (overlayWriter) {
+		int64 flushStart = monotonicMicros();
+		overlayWriter->flush();
+		log("overlays: %d saved, %d failed, %ld us waiting for the last ones\n", overlayWriter->written(),
+				overlayWriter->failed(), long(monotonicMicros() - flushStart));
+		delete overlayWriter;
+		overlayWriter = NULL;
+	}
 
-	for(vector<string>::iterator it = images.begin(); it != images.end(); ++it) {
-		string file = *it;
-		cout << "Checking first file " << file << endl;
-		string line_in = "";
+	//written in input order whatever order the workers finished in
+	int nFrames = 0, nBalloons = 0;
+	for (size_t i = 0; i < results.size(); i++) {
+		if (!results[i].loaded) {
+			continue;
+		}
+		if (detectionLog.isOpen()) {
+			detectionLog.write(int(i), results[i].stamp, results[i].detections);
+		}
+		nBalloons += (int)results[i].detections.size();
+		++nFrames;
+	}
+	detectionLog.close();
+	if (!opts.resultsPath.empty() && !writeResults(opts.resultsPath, resultsFormatFor(opts.resultsPath), results)) {
+		return(1);
+	}
 
-		captureFrame(file, frame_host, frame, debugOverlay);
-		convertToHSV(frame, hue, sat, val);
-		processFrame(hue, sat, balloonyness, debugOverlay);
-		displayOutput(frame_host, hue, sat, val, balloonyness, debugOverlay);
-		write_image(debugOverlay, file);
-		waitKey(0);
+	double totalTimeSec = double(monotonicMicros() - startTime) / 1000000.0;
+	fprintf(statusOut, "%d images (%d unreadable), %d balloons in %lf seconds\n", nFrames,
+			int(images.size()) - nFrames, nBalloons, totalTimeSec);
+	if (!opts.cacheDir.empty()) {
+		fprintf(statusOut, "cache: %d results reused, %d images not decoded\n", int(nResultCacheHits), int(nFrameCacheHits));
 	}
-	printf("terminating...\n");
+	dumpLatencyStats(statusOut);
+	fprintf(statusOut, "terminating...\n");
 }
@@ -0,0 +1,165 @@
+/*
+ * Accuracy versus throughput benchmark
+ * Description:
+ * Runs the detectors over the labelled distance photos at every FEED_SIZE
+ * the camera program can be built for and prints, per size and detector,
+ * how many balloons were found, how far off they were, how many false
+ * positives there were and what a frame cost (median and p99). Every speed
+ * up is also a trade against range, this puts both in one table.
+ *
+ * Each photo is cropped to the aspect of the size (the middle of the frame,
+ * like a 4:3 camera mode on a 16:9 sensor) and scaled down with area
+ * averaging, as the camera would deliver it. The labels follow.
+ *
+ * Usage:
+ *    make benchmark
+ *    ./benchmark [manifest] [--repeat N] [--threads N] [--csv PATH]
+ * The manifest defaults to ../photos/balloons.txt, see common/groundTruth.h.
+ */
+#include "opencv2/opencv.hpp"
+#include "../common/balloonDetector.h"
+#include "../common/pyramidDetector.h"
+#include "../common/detectionLog.h"
+#include "../common/groundTruth.h"
+#include "../common/latency.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+const double areaRatio = 0.65;
+
+//the FEED_SIZE settings of IdentifyBalloon_Camera
+const int nFeedSizes = 4;
+const Size feedSizes[nFeedSizes] = { Size(320, 240), Size(640, 480), Size(1280, 720), Size(1920, 1080) };
+
+enum DetectorMode {
+	FULL_FRAME,
+	PYRAMID,
+	N_MODES
+};
+const char *modeNames[N_MODES] = { "strip", "pyramid" };
+
+struct Row {
+	Size size;
+	int mode;
+	int images;
+	MatchStats match;
+	vector<double> frameMs;
+};
+
+double percentile(vector<double> samples, double p) {
+	if (samples.empty())
+		return 0;
+	sort(samples.begin(), samples.end());
+	size_t rank = size_t(p / 100.0 * (samples.size() - 1) + 0.5);
+	return samples[rank];
+}
+
+int main(int argc, char **argv) {
+	string manifest = "../photos/balloons.txt";
+	string csvPath;
+	int repeat = 10;
+	int threads = 0;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--repeat") && i + 1 < argc) {
+			repeat = max(1, atoi(argv[++i]));
+		} else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--csv") && i + 1 < argc) {
+			csvPath = argv[++i];
+		} else if (argv[i][0] == '-') {
+			fprintf(stderr, "usage: %s [manifest] [--repeat N] [--threads N] [--csv PATH]\n", argv[0]);
+			return 1;
+		} else {
+			manifest = argv[i];
+		}
+	}
+
+	vector<LabelledImage> images;
+	if (!loadManifest(manifest, images) || images.empty()) {
+		fprintf(stderr, "no labelled images in %s\n", manifest.c_str());
+		return 1;
+	}
+
+	BalloonDetector detector(BalloonynessParams(), threads);
+	PyramidDetector pyramid(detector);
+	printf("%d images, %d runs each, %d detector threads, pyramid factor %d\n",
+			(int)images.size(), repeat, detector.threads(), pyramid.factor());
+
+	vector<Row> rows;
+	for (int s = 0; s < nFeedSizes; s++) {
+		for (int m = 0; m < N_MODES; m++) {
+			Row row;
+			row.size = feedSizes[s];
+			row.mode = m;
+			row.images = 0;
+			rows.push_back(row);
+		}
+	}
+
+	Mat mask, frame;
+	vector<Blob> blobs;
+	vector<Detection> detections;
+	for (size_t i = 0; i < images.size(); i++) {
+		Mat original = imread(images[i].path, CV_LOAD_IMAGE_COLOR);
+		if (original.empty()) {
+			fprintf(stderr, "could not read %s\n", images[i].path.c_str());
+			continue;
+		}
+		for (size_t r = 0; r < rows.size(); r++) {
+			Row &row = rows[r];
+			Rect crop = centreCrop(original.size(), row.size);
+			resize(original(crop), frame, row.size, 0, 0, INTER_AREA);
+			vector<BalloonLabel> labels = scaleLabels(images[i].balloons, crop, row.size);
+			Rect whole(Point(0, 0), row.size);
+
+			for (int k = 0; k < repeat; k++) {
+				int64 start = monotonicMicros();
+				if (row.mode == PYRAMID)
+					pyramid.detect(frame, whole, mask, blobs);
+				else
+					detector.detect(frame, mask, blobs);
+				row.frameMs.push_back((monotonicMicros() - start) / 1000.0);
+			}
+			blobsToDetections(blobs, areaRatio, detections);
+			row.match.add(matchDetections(labels, detections));
+			++row.images;
+		}
+	}
+
+	FILE *csv = csvPath.empty() ? NULL : fopen(csvPath.c_str(), "w");
+	if (csv) {
+		fprintf(csv, "width,height,detector,images,labels,found,detection_rate,mean_error_px,"
+				"mean_radius_error_px,false_positives,median_ms,p99_ms\n");
+	} else if (!csvPath.empty()) {
+		perror(csvPath.c_str());
+	}
+
+	printf("%-10s %-8s %7s %7s %9s %9s %6s %9s %9s\n", "size", "detector", "found", "rate",
+			"err px", "r err px", "fp", "med ms", "p99 ms");
+	for (size_t r = 0; r < rows.size(); r++) {
+		const Row &row = rows[r];
+		char size[32];
+		sprintf(size, "%dx%d", row.size.width, row.size.height);
+		char found[32];
+		sprintf(found, "%d/%d", row.match.found, row.match.labels);
+		double median = percentile(row.frameMs, 50), p99 = percentile(row.frameMs, 99);
+		printf("%-10s %-8s %7s %6.0f%% %9.2f %9.2f %6d %9.3f %9.3f\n", size, modeNames[row.mode], found,
+				100 * row.match.detectionRate(), row.match.meanError(), row.match.meanRadiusError(),
+				row.match.falsePositives, median, p99);
+		if (csv) {
+			fprintf(csv, "%d,%d,%s,%d,%d,%d,%.3f,%.3f,%.3f,%d,%.3f,%.3f\n", row.size.width, row.size.height,
+					modeNames[row.mode], row.images, row.match.labels, row.match.found,
+					row.match.detectionRate(), row.match.meanError(), row.match.meanRadiusError(),
+					row.match.falsePositives, median, p99);
+		}
+	}
+	if (csv) {
+		fclose(csv);
+	}
+	return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Detector parameter sweep
+ * Description:
+ * Scores every combination of the given tuning parameters against the
+ * labelled distance photos and prints them ranked, best first: balloons
+ * found, false positives, how far off they were and what the parameters
+ * cost per frame. See common/paramSweep.h for how the work is shared
+ * between combinations.
+ *
+ * Each photo is cropped and scaled to the feed size like benchmark does.
+ *
+ * Usage:
+ *    make sweep
+ *    ./sweep [manifest] [--hue SPEC] [--hue-div SPEC] [--sat-div SPEC]
+ *            [--threshold SPEC] [--ratio SPEC] [--size WxH] [--threads N]
+ *            [--top N] [--csv PATH]
+ * SPEC is one value, a list (85,90,95) or a range (150:250:10). Parameters
+ * that are not given stay at the values the programs use. The manifest
+ * defaults to ../photos/balloons.txt, --size to 1280x720 (FEED_SIZE 3),
+ * 0x0 keeps the photos as they are.
+ */
+#include "opencv2/opencv.hpp"
+#include "../common/paramSweep.h"
+#include "../common/groundTruth.h"
+#include "../common/latency.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+const double areaRatio = 0.65;
+
+void usage(const char *program) {
+	fprintf(stderr, "usage: %s [manifest] [--hue SPEC] [--hue-div SPEC] [--sat-div SPEC] [--threshold SPEC]\n"
+			"       [--ratio SPEC] [--size WxH] [--threads N] [--top N] [--csv PATH]\n"
+			"SPEC is a value, a list a,b,c or a range first:last:step\n", program);
+}
+
+int main(int argc, char **argv) {
+	string manifest = "../photos/balloons.txt";
+	string csvPath;
+	Size size(1280, 720);
+	int threads = 0;
+	int top = 20;
+	SweepGrid grid(areaRatio);
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		bool ok = true;
+		if (!strcmp(arg, "--hue") && i + 1 < argc) {
+			ok = parseSweepValues(argv[++i], grid.hueCenters);
+		} else if (!strcmp(arg, "--hue-div") && i + 1 < argc) {
+			ok = parseSweepValues(argv[++i], grid.hueDivisors);
+		} else if (!strcmp(arg, "--sat-div") && i + 1 < argc) {
+			ok = parseSweepValues(argv[++i], grid.satDivisors);
+		} else if (!strcmp(arg, "--threshold") && i + 1 < argc) {
+			ok = parseSweepValues(argv[++i], grid.thresholds);
+		} else if (!strcmp(arg, "--ratio") && i + 1 < argc) {
+			ok = parseSweepValues(argv[++i], grid.minRoundness);
+		} else if (!strcmp(arg, "--size") && i + 1 < argc) {
+			ok = sscanf(argv[++i], "%dx%d", &size.width, &size.height) == 2 && size.width >= 0 && size.height >= 0;
+		} else if (!strcmp(arg, "--threads") && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (!strcmp(arg, "--top") && i + 1 < argc) {
+			top = atoi(argv[++i]);
+		} else if (!strcmp(arg, "--csv") && i + 1 < argc) {
+			csvPath = argv[++i];
+		} else if (arg[0] == '-') {
+			ok = false;
+		} else {
+			manifest = arg;
+		}
+		if (!ok) {
+			fprintf(stderr, "bad argument %s\n", argv[i]);
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	vector<double> divisors = grid.hueDivisors;
+	divisors.insert(divisors.end(), grid.satDivisors.begin(), grid.satDivisors.end());
+	if (cvRound(*min_element(divisors.begin(), divisors.end())) <= 0) {
+		fprintf(stderr, "divisors have to be at least 1\n");
+		return 1;
+	}
+
+	vector<LabelledImage> images;
+	if (!loadManifest(manifest, images) || images.empty()) {
+		fprintf(stderr, "no labelled images in %s\n", manifest.c_str());
+		return 1;
+	}
+
+	int64 start = monotonicMicros();
+	ParamSweep sweep(threads);
+	Mat frame;
+	for (size_t i = 0; i < images.size(); i++) {
+		Mat original = imread(images[i].path, CV_LOAD_IMAGE_COLOR);
+		if (original.empty()) {
+			fprintf(stderr, "could not read %s\n", images[i].path.c_str());
+			continue;
+		}
+		if (size.area() == 0) {
+			sweep.addImage(original, images[i].balloons);
+			continue;
+		}
+		Rect crop = centreCrop(original.size(), size);
+		resize(original(crop), frame, size, 0, 0, INTER_AREA);
+		sweep.addImage(frame, scaleLabels(images[i].balloons, crop, size));
+	}
+	if (sweep.images() == 0) {
+		return 1;
+	}
+	double loadSec = (monotonicMicros() - start) / 1000000.0;
+
+	start = monotonicMicros();
+	vector<SweepResult> results;
+	sweep.run(grid, results);
+	rankSweepResults(results);
+	double sweepSec = (monotonicMicros() - start) / 1000000.0;
+
+	const SweepStageCounts &counts = sweep.stageCounts();
+	printf("%d combinations on %d images with %d threads in %.2f s (%.2f s loading)\n", grid.size(),
+			sweep.images(), sweep.threads(), sweepSec, loadSec);
+	printf("stages run: colour %d, score %d, label %d, filter %d\n", counts.colour, counts.score,
+			counts.label, counts.filter);
+
+	printf("%4s %5s %7s %7s %9s %6s %7s %9s %6s %9s %9s\n", "rank", "hue", "hue div", "sat div",
+			"threshold", "ratio", "found", "err px", "fp", "cand/img", "label ms");
+	for (int k = 0; k < (int)results.size() && (top <= 0 || k < top); k++) {
+		const SweepResult &r = results[k];
+		char found[32];
+		sprintf(found, "%d/%d", r.match.found, r.match.labels);
+		printf("%4d %5d %7d %7d %9d %6.2f %7s %9.2f %6d %9.1f %9.3f\n", k + 1, r.params.hueCenter,
+				r.params.hueDivisor, r.params.satDivisor, r.params.threshold, r.minRoundness, found,
+				r.match.meanError(), r.match.falsePositives, r.candidates, r.labelMs);
+	}
+
+	if (!csvPath.empty()) {
+		FILE *csv = fopen(csvPath.c_str(), "w");
+		if (!csv) {
+			perror(csvPath.c_str());
+			return 1;
+		}
+		fprintf(csv, "rank,hue_center,hue_divisor,sat_divisor,threshold,min_roundness,images,labels,found,"
+				"detection_rate,mean_error_px,mean_radius_error_px,false_positives,candidates_per_image,label_ms\n");
+		for (size_t k = 0; k < results.size(); k++) {
+			const SweepResult &r = results[k];
+			fprintf(csv, "%d,%d,%d,%d,%d,%.3f,%d,%d,%d,%.3f,%.3f,%.3f,%d,%.2f,%.3f\n", int(k + 1),
+					r.params.hueCenter, r.params.hueDivisor, r.params.satDivisor, r.params.threshold,
+					r.minRoundness, r.images, r.match.labels, r.match.found, r.match.detectionRate(),
+					r.match.meanError(), r.match.meanRadiusError(), r.match.falsePositives, r.candidates, r.labelMs);
+		}
+		fclose(csv);
+	}
+	return 0;
+}
@@ -20,8 +20,13 @@
 #include "opencv2/gpu/gpu.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include <stdio.h>
+#include <string.h>
+#include "../common/morphology.h"
+#include "../common/blobs.h"
+#include "../common/frameInput.h"
 
 using namespace cv;
+using namespace std;
 //initial min and max HSV filter values.
 //these will be changed using trackbars
 int H_MIN = 0;
@@ -45,6 +50,129 @@ const string windowName1 = "HSV Image";
 const string windowName2 = "Thresholded Image";
 const string windowName3 = "After Morphological Operations";
 const string trackbarWindowName = "Trackbars";
+
+/*
+ * The blurred HSV planes of the frame being tuned on, a histogram of each
+ * plane and one byte per pixel with a bit set for every channel whose range
+ * the pixel is outside of. A new frame costs one pass over the planes; a
+ * moved trackbar only redoes that channel's bit, and only if the histogram
+ * says some pixel actually lies between the old and the new limit. Pixel
+ * counts per channel come from the histograms, the count of the combined
+ * mask is kept up to date by the passes themselves.
+ */
+class RangeTuner {
+public:
+	RangeTuner() : passing(0), displayStale(true) {
+		memset(hist, 0, sizeof(hist));
+		for (int c = 0; c < 3; c++) {
+			lo[c] = 0;
+			hi[c] = 255;
+		}
+	}
+
+	void setFrame(const Mat &feed) {
+		GaussianBlur(feed, blurred, Size(3,3), 0, 0, BORDER_DEFAULT);
+		cvtColor(blurred, blurred, CV_RGB2HSV);
+		split(blurred, planes);
+		fails.create(feed.size(), CV_8UC1);
+
+		uchar lut[3][256];
+		for (int c = 0; c < 3; c++) {
+			outsideTable(c, lut[c]);
+			memset(hist[c], 0, sizeof(hist[c]));
+		}
+		passing = 0;
+		int histRows[3][256] = {{0}};
+		for (int y = 0; y < fails.rows; y++) {
+			const uchar *h = planes[0].ptr<uchar>(y), *s = planes[1].ptr<uchar>(y), *v = planes[2].ptr<uchar>(y);
+			uchar *f = fails.ptr<uchar>(y);
+			for (int x = 0; x < fails.cols; x++) {
+				histRows[0][h[x]]++;
+				histRows[1][s[x]]++;
+				histRows[2][v[x]]++;
+				f[x] = lut[0][h[x]] | lut[1][s[x]] | lut[2][v[x]];
+				passing += f[x] == 0;
+			}
+		}
+		//cumulative, hist[c][n] is the number of pixels below n
+		for (int c = 0; c < 3; c++)
+			for (int n = 0; n < 256; n++)
+				hist[c][n + 1] = hist[c][n] + histRows[c][n];
+		displayStale = true;
+	}
+
+	//true if the mask changed
+	bool setRange(int c, int newLo, int newHi) {
+		if (newLo == lo[c] && newHi == hi[c])
+			return false;
+		//pixels that move in or out of the range are those between the old and the new limits
+		int moved = between(c, min(lo[c], newLo), max(lo[c], newLo) - 1) +
+				between(c, min(hi[c], newHi) + 1, max(hi[c], newHi));
+		lo[c] = newLo;
+		hi[c] = newHi;
+		if (moved == 0 || fails.empty())
+			return false;
+
+		uchar lut[256];
+		outsideTable(c, lut);
+		uchar keep = uchar(~(1 << c));
+		for (int y = 0; y < fails.rows; y++) {
+			const uchar *p = planes[c].ptr<uchar>(y);
+			uchar *f = fails.ptr<uchar>(y);
+			for (int x = 0; x < fails.cols; x++) {
+				uchar updated = (f[x] & keep) | lut[p[x]];
+				passing += (updated == 0) - (f[x] == 0);
+				f[x] = updated;
+			}
+		}
+		displayStale = true;
+		return true;
+	}
+
+	//pixels inside channel c's range and inside all three
+	int channelCount(int c) const { return between(c, lo[c], hi[c]); }
+	int maskCount() const { return passing; }
+	int pixels() const { return fails.rows * fails.cols; }
+
+	//per channel masks, their merge and the combined mask, rebuilt only after a change
+	void masks(vector<Mat> &channels, Mat &merged, Mat &combined) {
+		if (displayStale) {
+			for (int c = 0; c < 3; c++) {
+				Mat bit;
+				bitwise_and(fails, Scalar(1 << c), bit);
+				compare(bit, Scalar(0), channelMasks[c], CMP_EQ);
+			}
+			merge(channelMasks, 3, mergedMask);
+			compare(fails, Scalar(0), combinedMask, CMP_EQ);
+			displayStale = false;
+		}
+		channels.assign(channelMasks, channelMasks + 3);
+		merged = mergedMask;
+		combined = combinedMask;
+	}
+
+private:
+	//bit c for the values outside channel c's range, 0 inside
+	void outsideTable(int c, uchar *lut) const {
+		for (int n = 0; n < 256; n++)
+			lut[n] = (n < lo[c] || n > hi[c]) ? uchar(1 << c) : 0;
+	}
+
+	//pixels of channel c with a value in [a, b]
+	int between(int c, int a, int b) const {
+		a = max(a, 0);
+		b = min(b, 255);
+		return a > b ? 0 : hist[c][b + 1] - hist[c][a];
+	}
+
+	Mat blurred, planes[3], fails;
+	int hist[3][257];
+	int lo[3], hi[3];
+	int passing;
+	bool displayStale;
+	Mat channelMasks[3], mergedMask, combinedMask;
+};
+
 void on_trackbar( int, void* )
 {//This function gets called whenever a
 	// trackbar position is changed
@@ -114,67 +242,51 @@ void drawObject(int x, int y,Mat &frame){
 	putText(frame,intToString(x)+","+intToString(y),Point(x,y+30),1,1,Scalar(0,255,0),2);
 
 }
+//rectangle erode and dilate whose cost doesn't grow with the element, see common/morphology.h
+Morphology morph;
 void morphOps(Mat &thresh){
 
-	//create structuring element that will be used to "dilate" and "erode" image.
-	//the element chosen here is a 3px by 3px rectangle
-
-	Mat erodeElement = getStructuringElement( MORPH_RECT,Size(3,3));
-    //dilate with larger element so make sure object is nicely visible
-	Mat dilateElement = getStructuringElement( MORPH_RECT,Size(8,8));
-
-	erode(thresh,thresh,erodeElement);
-	erode(thresh,thresh,erodeElement);
-
-
-	dilate(thresh,thresh,dilateElement);
-	dilate(thresh,thresh,dilateElement);
-
-
+	//erode with a 3px by 3px rectangle, twice.
+	//dilate with larger element so make sure object is nicely visible
+	//each pair is done as one pass with the rectangle both passes together cover
+	morph.erode(thresh,thresh,Size(3,3),2);
+	morph.dilate(thresh,thresh,Size(8,8),2);
 
 }
-void trackFilteredObject(int &x, int &y, Mat threshold, Mat &cameraFeed){
-
-	Mat temp;
-	threshold.copyTo(temp);
-	//these two vectors needed for output of findContours
-	vector< vector<Point> > contours;
-	vector<Vec4i> hierarchy;
-	//find contours of filtered image using openCV findContours function
-	findContours(temp,contours,hierarchy,CV_RETR_CCOMP,CV_CHAIN_APPROX_SIMPLE );
-	//use moments method to find our filtered object
-	double refArea = 0;
+//labels the mask in one pass and gives up as soon as there are too many blobs, see common/blobs.h
+BlobAnalyser blobAnalyser;
+vector<Blob> blobs;
+void trackFilteredObject(int &x, int &y, const Mat &threshold, Mat &cameraFeed){
+
+	//if number of objects reaches MAX_NUM_OBJECTS we have a noisy filter, and
+	//the labelling stops there instead of finishing the frame
+	if(!blobAnalyser.analyse(threshold,blobs,MAX_NUM_OBJECTS)){
+		putText(cameraFeed,"TOO MUCH NOISE! ADJUST FILTER",Point(0,50),1,2,Scalar(0,0,255),2);
+		return;
+	}
+	//the blob moments are summed while labelling, no contours to walk afterwards
+	int refArea = 0;
 	bool objectFound = false;
-	if (hierarchy.size() > 0) {
-		int numObjects = hierarchy.size();
-        //if number of objects greater than MAX_NUM_OBJECTS we have a noisy filter
-        if(numObjects<MAX_NUM_OBJECTS){
-			for (int index = 0; index >= 0; index = hierarchy[index][0]) {
-
-				Moments moment = moments((cv::Mat)contours[index]);
-				double area = moment.m00;
-
-				//if the area is less than 20 px by 20px then it is probably just noise
-				//if the area is the same as the 3/2 of the image size, probably just a bad filter
-				//we only want the object with the largest area so we safe a reference area each
-				//iteration and compare it to the area in the next iteration.
-                if(area>MIN_OBJECT_AREA && area<MAX_OBJECT_AREA && area>refArea){
-					x = moment.m10/area;
-					y = moment.m01/area;
-					objectFound = true;
-					refArea = area;
-				}else objectFound = false;
-
-
-			}
-			//let user know you found an object
-			if(objectFound ==true){
-				putText(cameraFeed,"Tracking Object",Point(0,50),2,1,Scalar(0,255,0),2);
-				//draw object location on screen
-				drawObject(x,y,cameraFeed);}
-
-		}else putText(cameraFeed,"TOO MUCH NOISE! ADJUST FILTER",Point(0,50),1,2,Scalar(0,0,255),2);
+	for (size_t i = 0; i < blobs.size(); i++) {
+
+		int area = blobs[i].area;
+
+		//if the area is less than 20 px by 20px then it is probably just noise
+		//if the area is the same as the 3/2 of the image size, probably just a bad filter
+		//we only want the object with the largest area
+		if(area>MIN_OBJECT_AREA && area<MAX_OBJECT_AREA && area>refArea){
+			Point2f centre = blobs[i].centroid();
+			x = cvRound(centre.x);
+			y = cvRound(centre.y);
+			objectFound = true;
+			refArea = area;
+		}
 	}
+	//let user know you found an object
+	if(objectFound ==true){
+		putText(cameraFeed,"Tracking Object",Point(0,50),2,1,Scalar(0,255,0),2);
+		//draw object location on screen
+		drawObject(x,y,cameraFeed);}
 }
 int main(int argc, char* argv[])
 {
@@ -182,83 +294,98 @@ int main(int argc, char* argv[])
 	//program
     bool trackObjects = false;
     bool useMorphOps = false;
-	//Matrix to store each frame of the webcam feed
+	//the camera, a recording or a video file, see common/frameInput.h
+	FrameInputOptions inputOptions;
+	vector<string> args;
+	if (!parseFrameInputOptions(argc, argv, inputOptions, args))
+		return 1;
+	//Matrix to store each frame of the webcam feed. It shares the capture
+	//buffer (the view keeps it), nothing draws on it
+	FrameView feedView;
 	Mat cameraFeed;
-	//matrix storage for HSV image
-	Mat HSV;
-	vector<Mat> hsvplanes1(3);
-	//matrix storage for binary threshold image
-	Mat threshold;
+	int64 stamp;
+	//blurred hsv planes, histograms and masks of the frame being tuned on
+	RangeTuner tuner;
+	vector<Mat> channelMasks;
+	Mat HSV, threshold;
 	//x and y values for the location of the object
 	int x=0, y=0;
+	//p freezes the frame, then only a moved trackbar costs anything
+	bool paused = false;
 	//create slider bars for HSV filtering
 	createTrackbars();
-	//video capture object to acquire webcam feed
-	VideoCapture capture;
-	//open capture object at location zero (default location for webcam)
-	capture.open(0);
-	//set height and width of capture frame
-	capture.set(CV_CAP_PROP_FRAME_WIDTH,FRAME_WIDTH);
-	capture.set(CV_CAP_PROP_FRAME_HEIGHT,FRAME_HEIGHT);
+	//open the input, a camera is asked for the height and width of capture frame
+	FrameInput capture;
+	if (!capture.open(inputOptions, Size(FRAME_WIDTH, FRAME_HEIGHT)))
+		return 1;
 	//start an infinite loop where webcam feed is copied to cameraFeed matrix
 	//all of our operations will be performed within this loop
 	while(1){
-		//store image to matrix
-		capture.read(cameraFeed);
-		//convert frame from BGR to HSV colorspace
-
-		GaussianBlur( cameraFeed, cameraFeed, Size(3,3), 0, 0, BORDER_DEFAULT );
-		cvtColor( cameraFeed, cameraFeed, CV_RGB2HSV );
-		split(cameraFeed, hsvplanes1);
-		//absdiff(hsvplanes1[0], Scalar(90), hsvplanes1[0]);
-		cv::inRange(hsvplanes1[0], Scalar(H_MIN), Scalar(H_MAX), hsvplanes1[0]);
-		cv::inRange(hsvplanes1[1], Scalar(S_MIN), Scalar(S_MAX), hsvplanes1[1]);
-		cv::inRange(hsvplanes1[2], Scalar(V_MIN), Scalar(V_MAX), hsvplanes1[2]);
-
-		merge(hsvplanes1, HSV);
-		//cv::threshold(HSV, threshold, V_MIN, 255, THRESH_TOZERO);
-//
-		/// Apply Laplace function
-//		Laplacian( HSV, threshold, CV_16S, 3, 1, 0, BORDER_DEFAULT );
-//		convertScaleAbs( threshold, threshold );
-
-//		cvtColor(cameraFeed,HSV,COLOR_BGR2HSV);
-//		//filter HSV image between values and store filtered image to
-//		//threshold matrix
-//		vector<Mat> hsvplanes(3);
-//		cv::split(HSV, hsvplanes);
-//		cv::absdiff(hsvplanes[0], Scalar(90), hsvplanes[0]);
-//		cv::merge(hsvplanes, HSV);
-//		inRange(HSV,Scalar(H_MIN,S_MIN,V_MIN),Scalar(H_MAX,S_MAX,V_MAX),threshold);
-//		//perform morphological operations on thresholded image to eliminate noise
-//		//and emphasize the filtered object(s)
-//		if(useMorphOps)
-//		morphOps(threshold);
-//		//pass in thresholded frame to our object tracking function
-//		//this function will return the x and y coordinates of the
-//		//filtered object
-//		if(trackObjects)
-//			trackFilteredObject(x,y,threshold,cameraFeed);
-//
-//		//show frames
-		//imshow(windowName2,threshold);
-		imshow(windowName,cameraFeed);
-		imshow(windowName1,HSV);
-		imshow("HUE",hsvplanes1[0]);
-		imshow("SAT",hsvplanes1[1]);
-		imshow("VAL",hsvplanes1[2]);
+		bool changed = false;
+		if (!paused || cameraFeed.empty()) {
+			//store image to matrix. A file or recording that has ended stays on its last frame
+			if (!capture.read(feedView, stamp) || feedView.empty()) {
+				if (!capture.isLive()) {
+					if (cameraFeed.empty())
+						return 1;
+					paused = true;
+				}
+				waitKey(30);
+				continue;
+			}
+			cameraFeed = feedView.image();
+			//blur, convert to HSV and test every channel in one go
+			tuner.setFrame(cameraFeed);
+			changed = true;
+		}
+		//the trackbars write straight into these, only the channels that moved are redone
+		int lows[3] = { H_MIN, S_MIN, V_MIN }, highs[3] = { H_MAX, S_MAX, V_MAX };
+		for (int c = 0; c < 3; c++) {
+			changed |= tuner.setRange(c, lows[c], highs[c]);
+		}
+
+		if (changed) {
+			tuner.masks(channelMasks, HSV, threshold);
+			//pixel counts straight from the histograms
+			char counts[128];
+			double percent = 100.0 / max(1, tuner.pixels());
+			sprintf(counts, "H %d  S %d  V %d  all %d (%.1f%%)", tuner.channelCount(0), tuner.channelCount(1),
+					tuner.channelCount(2), tuner.maskCount(), tuner.maskCount() * percent);
+			Mat shown = threshold.clone();
+			Mat feed = cameraFeed;
+			//perform morphological operations on thresholded image to eliminate noise
+			//and emphasize the filtered object(s). The tuner's own mask stays as it is
+			if(useMorphOps)
+			morphOps(shown);
+			//pass in thresholded frame to our object tracking function
+			//this function will return the x and y coordinates of the
+			//filtered object
+			if(trackObjects) {
+				feed = cameraFeed.clone();
+				trackFilteredObject(x,y,shown,feed);
+			}
+			putText(shown, counts, Point(5, 20), 1, 1, Scalar(128), 1);
 
+			//show frames
+			imshow(windowName2,shown);
+			imshow(windowName,feed);
+			imshow(windowName1,HSV);
+			imshow("HUE",channelMasks[0]);
+			imshow("SAT",channelMasks[1]);
+			imshow("VAL",channelMasks[2]);
+		}
 
 		//delay 30ms so that screen can refresh.
 		//image will not appear without this waitKey() command
-		waitKey(30);
+		char c = (char)waitKey(30);
+		if (c == 'p') {
+			paused = !paused;
+		}
+		if (c == 27) {
+			break;
+		}
 	}
 
-
-
-
-
-
 	return 0;
 }
 
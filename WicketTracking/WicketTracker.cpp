@@ -15,16 +15,21 @@
  * 'p' it will pause the video and show computation time and fps. Hitting
  * 'd' will toggle debugging mode which will show or hide the frames as it
  * processes them. Turning it off will process frames quicker on the Jetson.
+ * --input picks another video, a recording made with --record or a camera
+ * (see common/frameInput.h).
  *
  * The main algorithm we are using here is template matching. It compares a
  * small image to the current frame and checks every spot where and tries to
  * find the best match. This is very slow algorithm. So to speed it up instead
  * of searching the whole frame we are using a kalman filter to predict where
- * we think the match will be in the next frame and search an area that is a
- * 1.5 times greater in each dimension that the image we are searching for. If
- * prediction were accurate then the area can be small, if not the area has to
- * be larger. Getting data from the IMU and extending the kalmand filter would
- * be a good way to improve prediction. However in this program we don't have
+ * we think the match will be in the next frame and search around it. The
+ * filter is a constant velocity one (common/kalman.h) stepped by the time
+ * between the frames' capture stamps, so a dropped frame is predicted across
+ * the whole gap, and the search margin is WICKET_SEARCH_SIGMAS times how
+ * uncertain the prediction is. While matches keep coming the margin stays
+ * small, when they stop it grows, and after a failed match the whole frame
+ * is searched. Getting data from the IMU and extending the kalmand filter
+ * would be a good way to improve prediction. However in this program we don't have
  * that data since the video was taken with a cell phone camera. The measurement
  * error of the match is near 0 so we can assume use a very low value for the
  * measurement error in the kalman filter. The images we are comparing are gray
@@ -51,7 +56,6 @@
  *  the first image in the list (hopefully a great match still) and only check one
  *  image.
  */
-#include "opencv2/video/tracking.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/calib3d/calib3d.hpp"
@@ -60,20 +64,38 @@
 #include <iostream>
 #include <ctype.h>
 #include <vector>
-#include <sys/time.h>
 #include <stdio.h>
+#include "../common/morphology.h"
+#include "../common/frameInput.h"
+#include "../common/kalman.h"
+#include "../common/latency.h"
 
 using namespace cv;
 using namespace cv::gpu;
 using namespace std;
 
+//frame is one unpaused pass up to the display
+LatencyStage loadLatency("load"),
+		convertLatency("convert"),
+		matchLatency("match"),
+		frameLatency("frame");
+
 Mat image, frame0, gray, sh;
-GpuMat gpu_frame0, gpu_gray, gpu_mask, gpu_thresh, gpu_temp;
+FrameView frameView; //keeps the buffer under frame0, which is only read
+GpuMat gpu_gray, gpu_mask, gpu_temp;
 vector<GpuMat> train_coll(8), mask_coll(8);
 vector<Rect> selections(8);
 
 const int thresh = 200; //threshold value for minimum gray scale value
-int element_shape = MORPH_RECT; //use a rectangle for erode and dialte
+
+//kalman filter: random acceleration px^2/s^3, match position variance px^2 (the match is near exact), starting velocity variance px^2/s^2
+const float WICKET_PROCESS_NOISE = 1e5f;
+const float WICKET_MEASUREMENT_NOISE = 1;
+const float WICKET_VELOCITY_VARIANCE = 1e4f;
+//search this many standard deviations of the predicted position around it, and at least WICKET_MIN_MARGIN pixels
+const float WICKET_SEARCH_SIGMAS = 3;
+const int WICKET_MIN_MARGIN = 16;
+Morphology morph; //rectangle erode and dilate on every core, see common/morphology.h
 
 Rect selection; //rectangle used for masking and selecting the area we want to track
 Point origin; //used in selecting
@@ -111,35 +133,6 @@ static void onMouse( int event, int x, int y, int, void* )
 		break;
 	}
 }
-/*
- * used to calculate the difference in time measurements
- */
-long getTimeDelta(struct timeval timea, struct timeval timeb) {
-	return 1000000 * (timeb.tv_sec - timea.tv_sec) +
-			(int(timeb.tv_usec) - int(timea.tv_usec));
-}
-/*
- * kalman_init
- * initializes the kalman filter to a starting state.
- * Inputs:
- * 		kal -> reference of a kalman filter object that is not null
- * 		p  	-> starting point of the object
- * 		processNoiseCov -> value of the noise that can happen during processing
- * 		measurementNoiseCov -> value representing noise of the measurement. Make this value smaller if the cv algorithm can accurately identify the location
- * 		errorCovPost -> value of the error somewhere kalman filter so tuning is required
- */
-void kalman_init(KalmanFilter &kal, Point p, double processNoiseCov, double measurementNoiseCov, double errorCovPost){
-	kal.statePre.at<float>(0) = p.x;
-	kal.statePre.at<float>(1) = p.y;
-	kal.statePre.at<float>(2) = 0;
-	kal.statePre.at<float>(3) = 0;
-	kal.transitionMatrix = *(Mat_<float>(4, 4) << 1,0,0,0,   0,1,0,0,  0,0,1,0,  0,0,0,1);
-
-	setIdentity(kal.measurementMatrix);
-	setIdentity(kal.processNoiseCov, Scalar::all(processNoiseCov));
-	setIdentity(kal.measurementNoiseCov, Scalar::all(measurementNoiseCov));
-	setIdentity(kal.errorCovPost, Scalar::all(errorCovPost));
-}
 /*
  * box_update
  * Updates the box that we are going to search for the template
@@ -151,20 +144,16 @@ void kalman_init(KalmanFilter &kal, Point p, double processNoiseCov, double meas
  * 		bb 	-> rectangle that is the size of the training image used to find the best point and is in the location of the match
  *
  * Outputs:
- * 		measurement -> the point to store the measured point
  * 		ctr_point -> the center point of the best match.
  * 		kal_point -> the center point adjusted by the kalman filter
  */
-void box_update(KalmanFilter &kal, Rect &bb, Mat_<float> &measurement, Point2f &ctr_point, Point2f &kal_point){
+void box_update(ConstantVelocityKalman &kal, Rect &bb, Point2f &ctr_point, Point2f &kal_point){
 	Point measp = Point(bb.tl().x + (bb.width / 2), bb.tl().y + (bb.height / 2));
-	//save measured matrix
-	measurement(0) = measp.x;
-	measurement(1) = measp.y;
 
 	ctr_point = measp; //save measured center point
 
-	Mat estimated = kal.correct(measurement); //correct the predicted center with the measurement point
-	Point statePt(estimated.at<float>(0),estimated.at<float>(1)); //the corrected center
+	kal.correct(measp); //correct the predicted center with the measurement point
+	Point statePt = kal.position(); //the corrected center
 	kal_point = statePt; //save the corrected point
 	//update selection so next time we have the mask in the right spot
 	selection.x = statePt.x - (bb.width/2);
@@ -177,23 +166,25 @@ void box_update(KalmanFilter &kal, Rect &bb, Mat_<float> &measurement, Point2f &
  * This function does the process to the current frame in the feed
  * that is used to setup the image for template matching
  *
- * frame to process: gpu_frame0
- * output of process to: gpu_gray
- * frames overwritten: gpu_gray, gpu_thresh
+ * The filtering is done on the cpu, the open with the running min/max of
+ * common/morphology.h costs the same for any element size. Only the gray
+ * result goes to the gpu for template matching, a third of the bytes of
+ * the colour frame.
+ *
+ * output of process to: gray and gpu_gray
+ * frames overwritten: gray, gpu_gray
  *
  * Inputs:
- * 		morphElement -> the element used for erosion and dilation
+ * 		frame -> the colour frame to process
+ * 		morphElement -> the size of the rectangle used for erosion and dilation
  * 		threshold -> the minimal gray scale value to include in the image
  */
-void proccess_frame(Mat morphElement, int threshold){
-	gpu::cvtColor(gpu_frame0, gpu_gray, COLOR_BGR2GRAY); //convert to gray scale
-	//gpu_mask = GpuMat(gpu_gray.size(), CV_8UC1, Scalar::all(0));
-	//gpu_mask(selection).setTo(Scalar::all(255));
-
-	gpu::threshold(gpu_gray, gpu_thresh, threshold, 255, THRESH_BINARY); //get rid of pixels less than the threshold
-	gpu::bitwise_and(gpu_gray, gpu_thresh, gpu_gray); //get the image with just the pixels that have values >= threshold
-	morphologyEx(gpu_gray, gpu_gray, CV_MOP_OPEN, morphElement); //perform erosion and dilation
-
+void proccess_frame(const Mat &frame, Size morphElement, int threshold){
+	cvtColor(frame, gray, COLOR_BGR2GRAY); //convert to gray scale
+	//get rid of pixels less than the threshold, the ones above keep their gray value
+	cv::threshold(gray, gray, threshold, 255, THRESH_TOZERO);
+	morph.open(gray, gray, morphElement); //perform erosion and dilation
+	gpu_gray.upload(gray);
 }
 /*
  * match_template
@@ -239,21 +230,24 @@ void match_template(GpuMat &test, vector<GpuMat> &train, vector<int> &index, dou
 	cerr << itr << " iterations " << best_val << endl;
 }
 
-int main( int argc, const char** argv )
+int main( int argc, char** argv )
 {
 
-	VideoCapture cap;
+	//the soccer goal video unless --input names a camera, recording or other file, see common/frameInput.h
+	FrameInputOptions inputOptions;
+	inputOptions.input = "/home/ubuntu/Aerial/photos/SoccerGoal2_464.mp4"; //open smaller video file (reccomended for Jetson)
+//	inputOptions.input = "/home/scott/Aerial//aerial_navigation/photos/SoccerGoal2.mp4"; //open regular video file (desktop)
+	vector<string> args;
+	if( !parseFrameInputOptions(argc, argv, inputOptions, args) )
+		return 1;
+	FrameInput cap;
+	int64 stamp;
 	Rect trackWindow;
 
-	struct timeval timea, timeb, timeS, timeE;
-	long totalTime = 0, matchTime = 0, convertTime = 0, loadTime = 0;
-	int nFrames = 0;
-
-	cap.open("/home/ubuntu/Aerial/photos/SoccerGoal2_464.mp4"); //open smaller video file (reccomended for Jetson)
-//	cap.open("/home/scott/Aerial//aerial_navigation/photos/SoccerGoal2.mp4"); //open regular video file (desktop)
+	cap.open(inputOptions, Size(640, 480));
 
-	cerr << cap.get(CV_CAP_PROP_FRAME_WIDTH) << endl;
-	cerr << cap.get(CV_CAP_PROP_FRAME_HEIGHT) << endl;
+	cerr << cap.size().width << endl;
+	cerr << cap.size().height << endl;
 	vector<string> screenshots;
 	//smaller training images (Jetson)
 	screenshots.push_back("/home/ubuntu/Aerial/WicketTraining/sh1_464.png");
@@ -281,11 +275,12 @@ int main( int argc, const char** argv )
 		return -1;
 	}
 	//define the shape that is to be used for errode and dilate. Change size to increase or decrease the amount erroded and dilated
-	Mat element = getStructuringElement(element_shape, Size(3, 3), Point(-1, -1) );
+	Size element(3, 3);
 
-	//Initialize kalman filter
-	KalmanFilter KF(4, 2, 0);
-	Mat_<float> measurement(2,1); measurement.setTo(Scalar(0));
+	//kalman filter, set up when tracking starts
+	ConstantVelocityKalman KF;
+	int64 lastStamp = 0; //capture time the filter was last stepped to
+	bool lost = false; //the last match failed, search the whole frame
 	Point pt(0, 0);
 
 	//intialize display window
@@ -298,7 +293,8 @@ int main( int argc, const char** argv )
 	bool paused = false;
 	bool debug = true;
 
-	cap >> frame0; //load the first frame
+	if( cap.read(frameView, stamp) ) //load the first frame
+		frame0 = frameView.image();
 	paused = true; //paused for training
 	vector<int> index(8); //indexes of the training images
 	Point2f ctr_point, kal_point;
@@ -312,10 +308,9 @@ int main( int argc, const char** argv )
 
 		for(;;){
 
-			gpu_frame0.upload(sh); //upload image to gpu memory
-			proccess_frame(element, thresh); //process the frame prior to selection
+			proccess_frame(sh, element, thresh); //process the frame prior to selection
 
-			gpu_gray.download(image); //download processed image so it can be displayed
+			gray.copyTo(image); //copy the processed image so it can be displayed
 			if(trackObject < 0) { //part of image has been selected so get the trained image
 
 				mask_coll[i] = GpuMat(gpu_gray.size(), CV_8UC1, Scalar::all(0)); //intialize a mask
@@ -341,14 +336,15 @@ int main( int argc, const char** argv )
 	//loop over frames in video feed (breaks at end of file)
 	for(;;)
 	{
-		gettimeofday(&timea, NULL); //start overal timer
+		int64_t passStart = monotonicMicros();
+		bool timed = !paused; //paused passes do nothing, they'd drag the frame times down
 		if( !paused )
 		{
-			gettimeofday(&timeS, NULL); //start image load timer
-			cap >> frame0; //load next frame
-			gettimeofday(&timeE, NULL); //end image load timer
-			loadTime += getTimeDelta(timeS, timeE); //add to the load time
-			nFrames++; //increment the frames proccessed count
+			ScopedLatency loadTimer(loadLatency);
+			frame0.release(); //the end of the file leaves it empty
+			if( cap.read(frameView, stamp) ) //load next frame
+				frame0 = frameView.image();
+			loadTimer.stop();
 			if( frame0.empty() ) //make sure we have a frame stored
 				break;
 		}
@@ -359,7 +355,9 @@ int main( int argc, const char** argv )
 				Point p = Point(selection.tl().x + (selection.width / 2), selection.tl().y + (selection.height / 2));
 				bb = selection; //bounding box for the search area is the selection
 
-				kalman_init(KF, p, 1e-4, 1e-4, .1); //initialize kalman filter.
+				KF.init(p, WICKET_PROCESS_NOISE, WICKET_MEASUREMENT_NOISE, WICKET_VELOCITY_VARIANCE); //initialize kalman filter.
+				lastStamp = stamp;
+				lost = false;
 
 				ctr_point = pt;
 				kal_point = pt;
@@ -368,36 +366,32 @@ int main( int argc, const char** argv )
 			}
 			if(trackObject){
 
-				Mat prediction = KF.predict(); //predict where the center of the match will be
-				Point predictPt(prediction.at<float>(0),prediction.at<float>(1)); //get the point
-				bool smallwindow = false;
-				if(predictPt.x != 0 || predictPt.y != 0){ //if the predicted point isn't the first (which is bad) then use the predicted point to set the search box location
-					smallwindow = true;
-					selection.x = predictPt.x - (selection.width/2);
-					selection.y = predictPt.y - (selection.height/2);
-				}
-
-				gettimeofday(&timeS, NULL); //start convert timer
-				gpu_frame0.upload(frame0); //upload frame to gpu memory
-				proccess_frame(element, thresh); //process the frame
-
-				gettimeofday(&timeE, NULL); //stop convert timer
-				convertTime += getTimeDelta(timeS, timeE);
+				KF.predict(float(stamp - lastStamp) / 1000000); //predict where the center of the match will be, however long ago the last frame was
+				lastStamp = stamp;
+				Point predictPt = KF.position(); //get the point
+				selection.x = predictPt.x - (selection.width/2);
+				selection.y = predictPt.y - (selection.height/2);
+
+				//search the predicted box and a margin as wide as the prediction is uncertain
+				int margin = MAX(cvRound(WICKET_SEARCH_SIGMAS * KF.positionSigma()), WICKET_MIN_MARGIN);
+				Rect predictRect = Rect(selection.x - margin, selection.y - margin, selection.width + 2 * margin, selection.height + 2 * margin) &
+						Rect(0, 0, frame0.cols, frame0.rows);
+				//every training image has to fit in the area or it is searched whole
+				bool smallwindow = !lost;
+				for(size_t i = 0; i < train_coll.size(); i++)
+					if(!train_coll[i].empty() && (train_coll[i].cols > predictRect.width || train_coll[i].rows > predictRect.height))
+						smallwindow = false;
+
+				ScopedLatency convertTimer(convertLatency);
+				proccess_frame(frame0, element, thresh); //process the frame and upload it to gpu memory
+				convertTimer.stop();
 				//gpu_gray.download(gray);
 
 				double best_max_value = 0;
 				Point best_location;
-				Rect predictRect;
 				int idx = 0;
-				gettimeofday(&timeS, NULL); //start match template timer
+				ScopedLatency matchTimer(matchLatency);
 				if(smallwindow){ //if we are using a small window to search for the template
-
-					//change the dimensions of the search box to be 3 times bigger than the size of the train image/selection
-					int wt = 1.5*selection.width;
-					int ht = 1.5*selection.height;
-					//set top left and bottom right locations of search area
-					predictRect = Rect(predictPt.x - wt, predictPt.y - ht, predictPt.x + wt, predictPt.y + ht);
-
 					GpuMat roi(gpu_gray, predictRect); //get area of image we want to search
 
 					match_template(roi, train_coll, index, best_max_value, best_location, idx); //run template match
@@ -405,21 +399,21 @@ int main( int argc, const char** argv )
 				} else //search the whole image (slow)
 					match_template(gpu_gray, train_coll, index, best_max_value, best_location, idx); //run template match
 
-				gettimeofday(&timeE, NULL); //end template match timer
-				matchTime += getTimeDelta(timeS, timeE);
+				matchTimer.stop();
 
 				if (best_max_value > .8){ //if the value found was better than .8 the update the found location. Otherwise we didn't find a good enough spot (this is not tuned and can be changed)
 					if(smallwindow){
 						best_location.x = best_location.x + predictRect.tl().x;
 						best_location.y = best_location.y + predictRect.tl().y;
 						bb = Rect(best_location.x,best_location.y, selections[index[idx]].width, selections[index[idx]].height);//box is now the size of the matched image and the location of the best fit
-						box_update(KF, bb, measurement, ctr_point, kal_point); //update the current location of the image and bounding box
+						box_update(KF, bb, ctr_point, kal_point); //update the current location of the image and bounding box
 					} else {
 						bb = Rect(best_location.x,best_location.y, selections[index[idx]].width, selections[index[idx]].height);
-						box_update(KF, bb, measurement, ctr_point, kal_point);
+						box_update(KF, bb, ctr_point, kal_point);
 					}
-				} else //the object wasn't in our window so search the whole image to find it.
-					smallwindow = false;
+					lost = false;
+				} else //the object wasn't in our window so search the whole image to find it next frame.
+					lost = true;
 
 			}
 		}
@@ -429,8 +423,8 @@ int main( int argc, const char** argv )
 			paused = false;
 		}
 
-		gettimeofday(&timeb, NULL); //stop total timer
-		totalTime += getTimeDelta(timea, timeb);
+		if( timed )
+			frameLatency.record(monotonicMicros() - passStart);
 		if(debug){ //if debugging then display the image and rectangles of where the kalman filter (red) things the best spot is and where the matched (yellow) spot is
 			frame0.copyTo(image);
 			rectangle(image, selection, Scalar(0, 0, 255), 1, 8, 0);
@@ -452,16 +446,14 @@ int main( int argc, const char** argv )
 			debug = !debug;
 			break;
 		case 'p':
+		{
 			paused = !paused;
-			cout << "frames                       : " << nFrames << endl;
-			cout << "TotalTime                    : " << double(totalTime)/1000000.0 << endl;
-			cout << "FPS                          : " << double(nFrames)/(double(totalTime)/1000000.0) << endl;
-			cout << "Percentage Convert Time      : " << double(convertTime)/double(totalTime) << endl;
-			cout << "Percentage Match Time        : " << double(matchTime)/double(totalTime) << endl;
-			cout << "Percentage Load Time         : " << double(loadTime)/double(totalTime) << endl;
-			totalTime = matchTime = convertTime = loadTime = 0;
-			nFrames = 0;
+			dumpLatencyStats(stdout);
+			LatencySnapshot frames = frameLatency.snapshot();
+			cout << "FPS                          : " << (frames.total > 0 ? frames.count / (frames.total / 1000000.0) : 0) << endl;
+			resetLatencyStats();
 			break;
+		}
 		default:
 			;
 		}
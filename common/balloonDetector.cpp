@@ -0,0 +1,105 @@
+/*
+ * Strip mined balloon detector
+ * Description:
+ * Splits the frame into strips, runs the balloonyness kernel and the blob
+ * analyser on each strip across the thread pool, then joins the blobs that
+ * cross strip boundaries. See balloonDetector.h.
+ */
+#include "balloonDetector.h"
+
+BalloonDetector::BalloonDetector(const BalloonynessParams &params, int threads, int stripRows) :
+		kernel(params), pool(threads), fixedStripRows(stripRows) {
+}
+
+int BalloonDetector::find(int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+//smaller index becomes the root, which keeps the raster order of first pixels
+void BalloonDetector::join(int a, int b) {
+	a = find(a);
+	b = find(b);
+	if (a < b)
+		parent[b] = a;
+	else if (b < a)
+		parent[a] = b;
+}
+
+/*
+ * the last row of upper is directly above the first row of lower, join every
+ * pair of runs that touch (8-connected, same test as BlobAnalyser)
+ */
+void BalloonDetector::joinStrips(const Strip &upper, int upperOffset, const Strip &lower, int lowerOffset) {
+	const vector<BlobRun> &above = upper.analyser.lastRowRuns();
+	const vector<BlobRun> &below = lower.analyser.firstRowRuns();
+	size_t p = 0;
+	for (size_t i = 0; i < below.size(); i++) {
+		while (p < above.size() && above[p].x1 < below[i].x0 - 1)
+			p++;
+		for (size_t q = p; q < above.size() && above[q].x0 <= below[i].x1 + 1; q++)
+			join(upperOffset + above[q].label, lowerOffset + below[i].label);
+	}
+}
+
+void BalloonDetector::detect(const Mat &bgr, Mat &mask, vector<Blob> &blobs) {
+	CV_Assert(bgr.type() == CV_8UC3);
+	mask.create(bgr.size(), CV_8UC1);
+
+	int rows = fixedStripRows;
+	if (rows <= 0)
+		rows = max(8, DETECTOR_STRIP_BYTES / max(1, bgr.cols * 4));
+	int count = (bgr.rows + rows - 1) / rows;
+	if ((int)strips.size() < count)
+		strips.resize(count);
+	for (int i = 0; i < count; i++) {
+		strips[i].rowStart = i * rows;
+		strips[i].rowEnd = min(bgr.rows, (i + 1) * rows);
+	}
+
+	pool.parallelFor(count, [&](int i) {
+		Strip &strip = strips[i];
+		kernel.applyRows(bgr, mask, strip.rowStart, strip.rowEnd);
+		strip.analyser.analyseRows(mask, strip.rowStart, strip.rowEnd, strip.blobs);
+	});
+
+	//strips are in raster order and so are the blobs in each strip
+	offsets.resize(count);
+	int total = 0;
+	for (int i = 0; i < count; i++) {
+		offsets[i] = total;
+		total += (int)strips[i].blobs.size();
+	}
+	parent.resize(total);
+	for (int i = 0; i < total; i++)
+		parent[i] = i;
+	for (int i = 0; i + 1 < count; i++)
+		joinStrips(strips[i], offsets[i], strips[i + 1], offsets[i + 1]);
+
+	//a root always comes before the pieces joined to it, so one pass folds everything
+	blobs.clear();
+	outIndex.resize(total);
+	for (int i = 0; i < count; i++) {
+		for (size_t b = 0; b < strips[i].blobs.size(); b++) {
+			int index = offsets[i] + (int)b;
+			int root = find(index);
+			if (root == index) {
+				outIndex[index] = (int)blobs.size();
+				blobs.push_back(strips[i].blobs[b]);
+			} else {
+				blobs[outIndex[root]].add(strips[i].blobs[b]);
+			}
+		}
+	}
+}
+
+void BalloonDetector::detect(const Mat &bgr, Rect window, Mat &mask, vector<Blob> &blobs) {
+	detect(bgr(window), mask, blobs);
+	if (window.tl() != Point(0, 0)) {
+		for (size_t i = 0; i < blobs.size(); i++)
+			blobs[i].shift(window.tl());
+	}
+}
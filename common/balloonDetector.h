@@ -0,0 +1,67 @@
+/*
+ * Strip mined balloon detector header file
+ * Description:
+ * Runs the whole candidate chain (bgr -> balloonyness -> threshold -> blob
+ * labelling) over horizontal strips of the frame instead of one stage over
+ * the whole frame at a time. A strip is sized so its bgr rows and mask rows
+ * fit in L2 together, so the mask is labelled while it is still in cache and
+ * never makes a round trip to memory. Strips are handed out to every core by
+ * a thread pool.
+ *
+ * Each strip is labelled on its own. Blobs that cross a strip boundary are
+ * joined afterwards by matching the runs of the last row of one strip with
+ * the first row of the next, and their moments (all integer sums) are added.
+ * The blobs, their order and the mask are exactly what the fused kernel plus
+ * one BlobAnalyser over the whole frame give.
+ *
+ * Note:
+ * - stripRows = 0 picks the strip height from the frame width.
+ * - Needs C++11 (-std=c++11 -pthread) for the thread pool.
+ */
+#ifndef BALLOON_DETECTOR_INCLUDED
+#define BALLOON_DETECTOR_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "balloonyness.h"
+#include "blobs.h"
+#include "threadPool.h"
+
+using namespace std;
+using namespace cv;
+
+//bytes of bgr + mask rows one strip should take up
+const int DETECTOR_STRIP_BYTES = 128 * 1024;
+
+class BalloonDetector {
+public:
+	BalloonDetector(const BalloonynessParams &params = BalloonynessParams(), int threads = 0, int stripRows = 0);
+
+	void setParams(const BalloonynessParams &params) { kernel.setParams(params); }
+	const BalloonynessKernel &balloonynessKernel() const { return kernel; }
+	int threads() const { return pool.size(); }
+
+	//mask is (re)allocated as CV_8UC1, blobs are in raster order of their first pixel
+	void detect(const Mat &bgr, Mat &mask, vector<Blob> &blobs);
+	//only inside window. mask is the size of the window, blobs are in frame coordinates
+	void detect(const Mat &bgr, Rect window, Mat &mask, vector<Blob> &blobs);
+
+private:
+	struct Strip {
+		int rowStart, rowEnd;
+		BlobAnalyser analyser;
+		vector<Blob> blobs;
+	};
+
+	int find(int i);
+	void join(int a, int b);
+	void joinStrips(const Strip &upper, int upperOffset, const Strip &lower, int lowerOffset);
+
+	BalloonynessKernel kernel;
+	ThreadPool pool;
+	int fixedStripRows;
+	vector<Strip> strips;
+	vector<int> offsets;   //index of each strip's first blob in the whole frame
+	vector<int> parent;    //union-find over every strip blob
+	vector<int> outIndex;  //where each root went in the output
+};
+#endif
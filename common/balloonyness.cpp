@@ -0,0 +1,376 @@
+/*
+ * Fused balloonyness kernel
+ * Description:
+ * This file contains the single pass BGR -> candidate mask kernel used in
+ * place of the cvtColor/split/absdiff/divide/multiply/threshold chain.
+ * Note:
+ * - Every row kernel does the same integer math as OpenCV's 8 bit BGR2HSV
+ *   conversion (same fixed point tables, same rounding), so the mask is bit
+ *   exact with the old chain. balloonynessTest checks this for every BGR value.
+ * - The divisions of the old chain round half to even (cvRound), that rounding
+ *   is folded into the minSat table so the kernels only do one compare at the end.
+ */
+#include "balloonyness.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+	(defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define HAVE_BALLOONYNESS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(__aarch64__)
+#define HAVE_BALLOONYNESS_NEON 1
+#include <arm_neon.h>
+#if !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+static const int hsv_shift = 12;
+
+/*
+ * divides like cv::divide does for 8 bit images: round to nearest, ties to even
+ */
+static int divideRound(int a, int d) {
+	if (d <= 0)
+		return 0;
+	int q = a / d, r = a % d;
+	if (2 * r > d || (2 * r == d && (q & 1)))
+		q++;
+	return q > 255 ? 255 : q;
+}
+
+static int hueTerm(int h, const BalloonynessParams &params) {
+	int center = params.hueCenter < 0 ? 0 : params.hueCenter > 255 ? 255 : params.hueCenter;
+	return divideRound(std::abs(h - center), params.hueDivisor);
+}
+
+static int satTerm(int s, const BalloonynessParams &params) {
+	return divideRound(s, params.satDivisor);
+}
+
+static void initTables(BalloonynessTables &tab, const BalloonynessParams &params) {
+	tab.hdiv[0] = tab.sdiv[0] = 0;
+	for (int i = 1; i < 256; i++) {
+		tab.hdiv[i] = saturate_cast<int>((180 << hsv_shift) / (6. * i));
+		tab.sdiv[i] = saturate_cast<int>((255 << hsv_shift) / (1. * i));
+	}
+	//satTerm never decreases with s, so each hue has a single saturation cut off
+	for (int h = 0; h < 256; h++) {
+		int hq = hueTerm(h, params);
+		tab.minSat[h] = 256;
+		for (int s = 0; s < 256; s++) {
+			if (std::min(255, hq * satTerm(s, params)) > params.threshold) {
+				tab.minSat[h] = s;
+				break;
+			}
+		}
+	}
+}
+
+static BalloonynessTables defaultTables() {
+	BalloonynessTables tab;
+	initTables(tab, BalloonynessParams());
+	return tab;
+}
+
+static const BalloonynessTables &hsvTables() {
+	static const BalloonynessTables tab = defaultTables();
+	return tab;
+}
+
+void bgrToHsv8u(int b, int g, int r, int &h, int &s, int &v) {
+	const BalloonynessTables &tab = hsvTables();
+	int vmin = std::min(b, std::min(g, r));
+	v = std::max(b, std::max(g, r));
+	int diff = v - vmin;
+
+	s = (diff * tab.sdiv[v] + (1 << (hsv_shift - 1))) >> hsv_shift;
+	if (v == r)
+		h = g - b;
+	else if (v == g)
+		h = b - r + 2 * diff;
+	else
+		h = r - g + 4 * diff;
+	h = (h * tab.hdiv[diff] + (1 << (hsv_shift - 1))) >> hsv_shift;
+	if (h < 0)
+		h += 180;
+}
+
+int balloonynessHsScore(int h, int s, const BalloonynessParams &params) {
+	return std::min(255, hueTerm(h, params) * satTerm(s, params));
+}
+
+int balloonynessScore(int b, int g, int r, const BalloonynessParams &params) {
+	int h, s, v;
+	bgrToHsv8u(b, g, r, h, s, v);
+	return balloonynessHsScore(h, s, params);
+}
+
+/*
+ * scalar row kernel, also handles the tail of the SIMD kernels
+ */
+static void balloonynessRow_scalar(const uchar *bgr, uchar *mask, int width, const BalloonynessTables &tab) {
+	for (int x = 0; x < width; x++, bgr += 3) {
+		int b = bgr[0], g = bgr[1], r = bgr[2];
+		int v = std::max(b, std::max(g, r));
+		int diff = v - std::min(b, std::min(g, r));
+		int s = (diff * tab.sdiv[v] + (1 << (hsv_shift - 1))) >> hsv_shift;
+		int h;
+		if (v == r)
+			h = g - b;
+		else if (v == g)
+			h = b - r + 2 * diff;
+		else
+			h = r - g + 4 * diff;
+		h = (h * tab.hdiv[diff] + (1 << (hsv_shift - 1))) >> hsv_shift;
+		if (h < 0)
+			h += 180;
+		mask[x] = s >= tab.minSat[h] ? 255 : 0;
+	}
+}
+
+#ifdef HAVE_BALLOONYNESS_X86
+/*
+ * splits 8 interleaved BGR pixels (24 bytes, nothing read past them) into
+ * three registers holding 8 bytes each in the low half
+ */
+__attribute__((target("sse4.1"))) static inline
+void loadBgr8_sse(const uchar *p, __m128i &b, __m128i &g, __m128i &r) {
+	__m128i lo = _mm_loadu_si128((const __m128i*)p);
+	__m128i hi = _mm_loadl_epi64((const __m128i*)(p + 16));
+	__m128i mid = _mm_alignr_epi8(hi, lo, 8);
+	__m128i a = _mm_shuffle_epi8(lo, _mm_setr_epi8(0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -1, -1, -1, -1));
+	__m128i c = _mm_shuffle_epi8(mid, _mm_setr_epi8(4, 7, 10, 13, 5, 8, 11, 14, 6, 9, 12, 15, -1, -1, -1, -1));
+	__m128i bg = _mm_unpacklo_epi32(a, c);
+	b = bg;
+	g = _mm_srli_si128(bg, 8);
+	r = _mm_unpackhi_epi32(a, c);
+}
+
+__attribute__((target("sse4.1"))) static inline
+__m128i gather4_sse(const int *table, __m128i idx) {
+	return _mm_setr_epi32(table[_mm_extract_epi32(idx, 0)], table[_mm_extract_epi32(idx, 1)],
+			table[_mm_extract_epi32(idx, 2)], table[_mm_extract_epi32(idx, 3)]);
+}
+
+//4 pixels in 32 bit lanes -> 0/-1 candidate lanes
+__attribute__((target("sse4.1"))) static inline
+__m128i candidates4_sse(__m128i b, __m128i g, __m128i r, const BalloonynessTables &tab) {
+	const __m128i round = _mm_set1_epi32(1 << (hsv_shift - 1));
+	__m128i v = _mm_max_epi32(_mm_max_epi32(b, g), r);
+	__m128i diff = _mm_sub_epi32(v, _mm_min_epi32(_mm_min_epi32(b, g), r));
+	__m128i s = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(diff, gather4_sse(tab.sdiv, v)), round), hsv_shift);
+
+	__m128i diff2 = _mm_add_epi32(diff, diff);
+	__m128i hr = _mm_sub_epi32(g, b);
+	__m128i hg = _mm_add_epi32(_mm_sub_epi32(b, r), diff2);
+	__m128i hb = _mm_add_epi32(_mm_sub_epi32(r, g), _mm_add_epi32(diff2, diff2));
+	__m128i h = _mm_blendv_epi8(hb, hg, _mm_cmpeq_epi32(v, g));
+	h = _mm_blendv_epi8(h, hr, _mm_cmpeq_epi32(v, r));
+	h = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(h, gather4_sse(tab.hdiv, diff)), round), hsv_shift);
+	h = _mm_add_epi32(h, _mm_and_si128(_mm_cmplt_epi32(h, _mm_setzero_si128()), _mm_set1_epi32(180)));
+
+	//s >= minSat[h]
+	return _mm_xor_si128(_mm_cmpgt_epi32(gather4_sse(tab.minSat, h), s), _mm_set1_epi32(-1));
+}
+
+__attribute__((target("sse4.1")))
+static void balloonynessRow_sse41(const uchar *bgr, uchar *mask, int width, const BalloonynessTables &tab) {
+	int x = 0;
+	for (; x <= width - 8; x += 8) {
+		__m128i b, g, r;
+		loadBgr8_sse(bgr + 3 * x, b, g, r);
+		__m128i m0 = candidates4_sse(_mm_cvtepu8_epi32(b), _mm_cvtepu8_epi32(g), _mm_cvtepu8_epi32(r), tab);
+		__m128i m1 = candidates4_sse(_mm_cvtepu8_epi32(_mm_srli_si128(b, 4)),
+				_mm_cvtepu8_epi32(_mm_srli_si128(g, 4)), _mm_cvtepu8_epi32(_mm_srli_si128(r, 4)), tab);
+		__m128i m = _mm_packs_epi32(m0, m1);
+		_mm_storel_epi64((__m128i*)(mask + x), _mm_packs_epi16(m, m));
+	}
+	balloonynessRow_scalar(bgr + 3 * x, mask + x, width - x, tab);
+}
+
+__attribute__((target("avx2")))
+static void balloonynessRow_avx2(const uchar *bgr, uchar *mask, int width, const BalloonynessTables &tab) {
+	const __m256i round = _mm256_set1_epi32(1 << (hsv_shift - 1));
+	int x = 0;
+	for (; x <= width - 8; x += 8) {
+		__m128i b8, g8, r8;
+		loadBgr8_sse(bgr + 3 * x, b8, g8, r8);
+		__m256i b = _mm256_cvtepu8_epi32(b8), g = _mm256_cvtepu8_epi32(g8), r = _mm256_cvtepu8_epi32(r8);
+
+		__m256i v = _mm256_max_epi32(_mm256_max_epi32(b, g), r);
+		__m256i diff = _mm256_sub_epi32(v, _mm256_min_epi32(_mm256_min_epi32(b, g), r));
+		__m256i s = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(diff,
+				_mm256_i32gather_epi32(tab.sdiv, v, 4)), round), hsv_shift);
+
+		__m256i diff2 = _mm256_add_epi32(diff, diff);
+		__m256i hr = _mm256_sub_epi32(g, b);
+		__m256i hg = _mm256_add_epi32(_mm256_sub_epi32(b, r), diff2);
+		__m256i hb = _mm256_add_epi32(_mm256_sub_epi32(r, g), _mm256_add_epi32(diff2, diff2));
+		__m256i h = _mm256_blendv_epi8(hb, hg, _mm256_cmpeq_epi32(v, g));
+		h = _mm256_blendv_epi8(h, hr, _mm256_cmpeq_epi32(v, r));
+		h = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(h,
+				_mm256_i32gather_epi32(tab.hdiv, diff, 4)), round), hsv_shift);
+		h = _mm256_add_epi32(h, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), h), _mm256_set1_epi32(180)));
+
+		__m256i m = _mm256_xor_si256(_mm256_cmpgt_epi32(_mm256_i32gather_epi32(tab.minSat, h, 4), s),
+				_mm256_set1_epi32(-1));
+		__m128i m16 = _mm_packs_epi32(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+		_mm_storel_epi64((__m128i*)(mask + x), _mm_packs_epi16(m16, m16));
+	}
+	balloonynessRow_scalar(bgr + 3 * x, mask + x, width - x, tab);
+}
+#endif
+
+#ifdef HAVE_BALLOONYNESS_NEON
+static inline int32x4_t widen_lo(uint8x8_t a) {
+	return vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(vmovl_u8(a))));
+}
+
+static inline int32x4_t widen_hi(uint8x8_t a) {
+	return vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(vmovl_u8(a))));
+}
+
+//NEON has no gather so table lookups go through the stack
+static inline uint32x4_t candidates4_neon(int32x4_t b, int32x4_t g, int32x4_t r, int32x4_t v, int32x4_t diff,
+		const int *sd, const int *hd, const BalloonynessTables &tab) {
+	const int32x4_t round = vdupq_n_s32(1 << (hsv_shift - 1));
+	int32x4_t s = vshrq_n_s32(vaddq_s32(vmulq_s32(diff, vld1q_s32(sd)), round), hsv_shift);
+
+	int32x4_t diff2 = vaddq_s32(diff, diff);
+	int32x4_t hr = vsubq_s32(g, b);
+	int32x4_t hg = vaddq_s32(vsubq_s32(b, r), diff2);
+	int32x4_t hb = vaddq_s32(vsubq_s32(r, g), vaddq_s32(diff2, diff2));
+	int32x4_t h = vbslq_s32(vceqq_s32(v, r), hr, vbslq_s32(vceqq_s32(v, g), hg, hb));
+	h = vshrq_n_s32(vaddq_s32(vmulq_s32(h, vld1q_s32(hd)), round), hsv_shift);
+	h = vaddq_s32(h, vandq_s32(vreinterpretq_s32_u32(vcltq_s32(h, vdupq_n_s32(0))), vdupq_n_s32(180)));
+
+	int hv[4], ms[4];
+	vst1q_s32(hv, h);
+	for (int i = 0; i < 4; i++)
+		ms[i] = tab.minSat[hv[i]];
+	return vcgeq_s32(s, vld1q_s32(ms));
+}
+
+static void balloonynessRow_neon(const uchar *bgr, uchar *mask, int width, const BalloonynessTables &tab) {
+	int x = 0;
+	for (; x <= width - 8; x += 8) {
+		uint8x8x3_t px = vld3_u8(bgr + 3 * x);
+		uint8x8_t v8 = vmax_u8(vmax_u8(px.val[0], px.val[1]), px.val[2]);
+		uint8x8_t diff8 = vsub_u8(v8, vmin_u8(vmin_u8(px.val[0], px.val[1]), px.val[2]));
+
+		uchar va[8], da[8];
+		int sd[8], hd[8];
+		vst1_u8(va, v8);
+		vst1_u8(da, diff8);
+		for (int i = 0; i < 8; i++) {
+			sd[i] = tab.sdiv[va[i]];
+			hd[i] = tab.hdiv[da[i]];
+		}
+
+		uint32x4_t m0 = candidates4_neon(widen_lo(px.val[0]), widen_lo(px.val[1]), widen_lo(px.val[2]),
+				widen_lo(v8), widen_lo(diff8), sd, hd, tab);
+		uint32x4_t m1 = candidates4_neon(widen_hi(px.val[0]), widen_hi(px.val[1]), widen_hi(px.val[2]),
+				widen_hi(v8), widen_hi(diff8), sd + 4, hd + 4, tab);
+		vst1_u8(mask + x, vmovn_u16(vcombine_u16(vmovn_u32(m0), vmovn_u32(m1))));
+	}
+	balloonynessRow_scalar(bgr + 3 * x, mask + x, width - x, tab);
+}
+#endif
+
+static BalloonynessRowFunc rowFuncFor(int path) {
+	switch (path) {
+#ifdef HAVE_BALLOONYNESS_X86
+	case BALLOONYNESS_SSE41:
+		return balloonynessRow_sse41;
+	case BALLOONYNESS_AVX2:
+		return balloonynessRow_avx2;
+#endif
+#ifdef HAVE_BALLOONYNESS_NEON
+	case BALLOONYNESS_NEON:
+		return balloonynessRow_neon;
+#endif
+	default:
+		return balloonynessRow_scalar;
+	}
+}
+
+bool balloonynessPathSupported(int path) {
+	switch (path) {
+	case BALLOONYNESS_SCALAR:
+		return true;
+#ifdef HAVE_BALLOONYNESS_X86
+	case BALLOONYNESS_SSE41:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse4.1");
+	case BALLOONYNESS_AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+#ifdef HAVE_BALLOONYNESS_NEON
+	case BALLOONYNESS_NEON:
+#if defined(__aarch64__)
+		return true;
+#else
+		return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+#endif
+	default:
+		return false;
+	}
+}
+
+int balloonynessBestPath() {
+	static const int order[] = { BALLOONYNESS_AVX2, BALLOONYNESS_SSE41, BALLOONYNESS_NEON };
+	for (int i = 0; i < 3; i++) {
+		if (balloonynessPathSupported(order[i]))
+			return order[i];
+	}
+	return BALLOONYNESS_SCALAR;
+}
+
+const char *balloonynessPathName(int path) {
+	switch (path) {
+	case BALLOONYNESS_SCALAR:
+		return "scalar";
+	case BALLOONYNESS_SSE41:
+		return "sse4.1";
+	case BALLOONYNESS_AVX2:
+		return "avx2";
+	case BALLOONYNESS_NEON:
+		return "neon";
+	default:
+		return "auto";
+	}
+}
+
+BalloonynessKernel::BalloonynessKernel(const BalloonynessParams &params, int path) {
+	if (path == BALLOONYNESS_AUTO || !balloonynessPathSupported(path))
+		path = balloonynessBestPath();
+	rowPath = path;
+	rowFunc = rowFuncFor(path);
+	setParams(params);
+}
+
+void BalloonynessKernel::setParams(const BalloonynessParams &params) {
+	par = params;
+	initTables(tab, par);
+}
+
+void BalloonynessKernel::apply(const Mat &bgr, Mat &mask) const {
+	mask.create(bgr.size(), CV_8UC1);
+	applyRows(bgr, mask, 0, bgr.rows);
+}
+
+void BalloonynessKernel::applyRows(const Mat &bgr, Mat &mask, int rowStart, int rowEnd) const {
+	CV_Assert(bgr.type() == CV_8UC3 && mask.type() == CV_8UC1 && mask.size() == bgr.size());
+	for (int y = rowStart; y < rowEnd; y++)
+		rowFunc(bgr.ptr<uchar>(y), mask.ptr<uchar>(y), bgr.cols, tab);
+}
+
+void balloonynessMask(const Mat &bgr, Mat &mask) {
+	static const BalloonynessKernel kernel;
+	kernel.apply(bgr, mask);
+}
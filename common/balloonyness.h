@@ -0,0 +1,94 @@
+/*
+ * Fused balloonyness kernel header file
+ * Description:
+ * Goes straight from BGR pixels to the binary candidate mask used by the
+ * balloon detector. It produces exactly the same mask as the original chain
+ *
+ *     cvtColor(BGR2HSV) -> split -> absdiff(hue, 90) -> divide by 4
+ *     -> divide(sat, 16) -> multiply -> threshold(200, 255, THRESH_BINARY)
+ *
+ * but in a single pass with no intermediate planes. The row kernel is picked
+ * at runtime from the instruction sets the cpu supports (AVX2 or SSE4.1 on
+ * x86, NEON on ARM) with a plain scalar version as the fallback.
+ *
+ * Note:
+ * - The SIMD paths are only compiled in with gcc 4.9 or newer on x86 and when
+ *   building with -mfpu=neon (or for aarch64) on ARM.
+ */
+#ifndef BALLOONYNESS_INCLUDED
+#define BALLOONYNESS_INCLUDED
+#include <opencv2/core/core.hpp>
+
+using namespace cv;
+
+/*
+ * tuning constants of the balloonyness score
+ * score = (|hue - hueCenter| / hueDivisor) * (sat / satDivisor)
+ * a pixel is a candidate when score > threshold
+ */
+struct BalloonynessParams {
+	int hueCenter;
+	int hueDivisor;
+	int satDivisor;
+	int threshold;
+
+	BalloonynessParams() : hueCenter(90), hueDivisor(4), satDivisor(16), threshold(200) {}
+};
+
+//row kernels that can be selected. BALLOONYNESS_AUTO picks the best supported one
+enum BalloonynessPath {
+	BALLOONYNESS_AUTO = -1,
+	BALLOONYNESS_SCALAR = 0,
+	BALLOONYNESS_SSE41,
+	BALLOONYNESS_AVX2,
+	BALLOONYNESS_NEON,
+	BALLOONYNESS_NPATHS
+};
+
+/*
+ * Lookup tables shared by every row kernel. hdiv/sdiv are the same fixed point
+ * reciprocal tables OpenCV uses for its 8 bit BGR2HSV conversion, minSat[h] is
+ * the smallest saturation that makes a pixel with hue h pass the threshold
+ * (256 if none does). Only minSat depends on the parameters.
+ */
+struct BalloonynessTables {
+	int hdiv[256];
+	int sdiv[256];
+	int minSat[256];
+};
+
+typedef void (*BalloonynessRowFunc)(const uchar *bgr, uchar *mask, int width, const BalloonynessTables &tab);
+
+class BalloonynessKernel {
+public:
+	BalloonynessKernel(const BalloonynessParams &params = BalloonynessParams(), int path = BALLOONYNESS_AUTO);
+
+	void setParams(const BalloonynessParams &params);
+	const BalloonynessParams &params() const { return par; }
+	int path() const { return rowPath; }
+
+	//full frame: bgr is CV_8UC3, mask is (re)allocated as CV_8UC1 of the same size
+	void apply(const Mat &bgr, Mat &mask) const;
+	//rows [rowStart, rowEnd) only. mask must already be allocated
+	void applyRows(const Mat &bgr, Mat &mask, int rowStart, int rowEnd) const;
+
+private:
+	BalloonynessParams par;
+	BalloonynessTables tab;
+	BalloonynessRowFunc rowFunc;
+	int rowPath;
+};
+
+//per pixel score and candidate test, used by the scalar kernel and for building lookup tables
+int balloonynessScore(int b, int g, int r, const BalloonynessParams &params);
+//same score for a pixel already converted to 8 bit hue and saturation
+int balloonynessHsScore(int h, int s, const BalloonynessParams &params);
+void bgrToHsv8u(int b, int g, int r, int &h, int &s, int &v);
+
+bool balloonynessPathSupported(int path);
+int balloonynessBestPath();
+const char *balloonynessPathName(int path);
+
+//convenience wrapper using the default parameters and the best path
+void balloonynessMask(const Mat &bgr, Mat &mask);
+#endif
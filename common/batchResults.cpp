@@ -0,0 +1,110 @@
+/*
+ * Batch results
+ * Description:
+ * csv and json writing of the per image results table. See batchResults.h.
+ */
+#include "batchResults.h"
+#include <stdio.h>
+
+int ImageResult::largest() const {
+	int best = -1;
+	for (size_t i = 0; i < detections.size(); i++) {
+		if (best < 0 || detections[i].area > detections[best].area)
+			best = (int)i;
+	}
+	return best;
+}
+
+int resultsFormatFor(const string &path) {
+	const string ext = ".json";
+	if (path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0)
+		return RESULTS_JSON;
+	return RESULTS_CSV;
+}
+
+static void writeJsonString(FILE *file, const string &s) {
+	fputc('"', file);
+	for (size_t i = 0; i < s.size(); i++) {
+		unsigned char c = s[i];
+		if (c == '"' || c == '\\')
+			fprintf(file, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(file, "\\u%04x", c);
+		else
+			fputc(c, file);
+	}
+	fputc('"', file);
+}
+
+//fields with commas or quotes in them get quoted, quotes doubled
+static void writeCsvField(FILE *file, const string &s) {
+	if (s.find_first_of(",\"\n") == string::npos) {
+		fputs(s.c_str(), file);
+		return;
+	}
+	fputc('"', file);
+	for (size_t i = 0; i < s.size(); i++) {
+		if (s[i] == '"')
+			fputc('"', file);
+		fputc(s[i], file);
+	}
+	fputc('"', file);
+}
+
+static void writeCsv(FILE *file, const vector<ImageResult> &results) {
+	fprintf(file, "image,width,height,loaded,cached,candidates,balloons,x,y,radius,roundness,area,"
+			"load_us,detect_us,overlay_us,write_us\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const ImageResult &r = results[i];
+		writeCsvField(file, r.path);
+		fprintf(file, ",%d,%d,%d,%d,%d,%d", r.size.width, r.size.height, r.loaded ? 1 : 0,
+				r.cached ? 1 : 0, r.candidates, (int)r.detections.size());
+		int best = r.largest();
+		if (best >= 0) {
+			const Detection &d = r.detections[best];
+			fprintf(file, ",%.2f,%.2f,%.2f,%.3f,%d", d.center.x, d.center.y, d.radius, d.roundness, d.area);
+		} else {
+			fprintf(file, ",,,,,");
+		}
+		fprintf(file, ",%ld,%ld,%ld,%ld\n", r.loadUs, r.detectUs, r.overlayUs, r.writeUs);
+	}
+}
+
+static void writeJson(FILE *file, const vector<ImageResult> &results) {
+	fprintf(file, "[\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const ImageResult &r = results[i];
+		fprintf(file, "  {\"image\": ");
+		writeJsonString(file, r.path);
+		fprintf(file, ", \"width\": %d, \"height\": %d, \"loaded\": %s, \"cached\": %s, \"candidates\": %d,\n",
+				r.size.width, r.size.height, r.loaded ? "true" : "false", r.cached ? "true" : "false", r.candidates);
+		fprintf(file, "   \"times_us\": {\"load\": %ld, \"detect\": %ld, \"overlay\": %ld, \"write\": %ld},\n",
+				r.loadUs, r.detectUs, r.overlayUs, r.writeUs);
+		fprintf(file, "   \"detections\": [");
+		for (size_t j = 0; j < r.detections.size(); j++) {
+			const Detection &d = r.detections[j];
+			fprintf(file, "%s\n    {\"x\": %.2f, \"y\": %.2f, \"radius\": %.2f, \"roundness\": %.3f, \"area\": %d}",
+					j ? "," : "", d.center.x, d.center.y, d.radius, d.roundness, d.area);
+		}
+		fprintf(file, "%s]}%s\n", r.detections.empty() ? "" : "\n   ", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "]\n");
+}
+
+bool writeResults(const string &path, int format, const vector<ImageResult> &results) {
+	bool toStdout = path == "-";
+	FILE *file = toStdout ? stdout : fopen(path.c_str(), "w");
+	if (!file) {
+		perror(path.c_str());
+		return false;
+	}
+	if (format == RESULTS_JSON)
+		writeJson(file, results);
+	else
+		writeCsv(file, results);
+	if (toStdout)
+		fflush(file);
+	else
+		fclose(file);
+	return true;
+}
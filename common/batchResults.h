@@ -0,0 +1,50 @@
+/*
+ * Batch results header file
+ * Description:
+ * One row of results per image for batch runs over directories of stills:
+ * what was found and how long each stage took. Written as a table once the
+ * whole batch is done, in input order whatever order the images finished in.
+ *
+ * csv: one line per image, the largest balloon in x,y,radius,roundness,area
+ *    image,width,height,loaded,cached,candidates,balloons,x,y,radius,roundness,area,
+ *    load_us,detect_us,overlay_us,write_us
+ * json: an array of one object per image with every balloon in "detections".
+ *
+ * Note:
+ * - "-" as the path writes to stdout.
+ * - candidates are all the blobs, balloons the ones that passed the roundness test.
+ */
+#ifndef BATCH_RESULTS_INCLUDED
+#define BATCH_RESULTS_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+#include "detectionLog.h"
+
+using namespace std;
+using namespace cv;
+
+enum ResultsFormat {
+	RESULTS_CSV,
+	RESULTS_JSON
+};
+
+struct ImageResult {
+	string path;
+	bool loaded;
+	bool cached;                 //came out of the result cache, nothing was run
+	Size size;
+	int candidates;
+	vector<Detection> detections;
+	int64 stamp;                 //monotonicMicros() when it was detected
+	long loadUs, detectUs, overlayUs, writeUs;
+
+	ImageResult() : loaded(false), cached(false), candidates(0), stamp(0), loadUs(0), detectUs(0), overlayUs(0), writeUs(0) {}
+	//index of the detection with the largest area, -1 for none
+	int largest() const;
+};
+
+//json for paths ending in .json, csv otherwise
+int resultsFormatFor(const string &path);
+bool writeResults(const string &path, int format, const vector<ImageResult> &results);
+#endif
@@ -0,0 +1,233 @@
+/*
+ * Blob analyser
+ * Description:
+ * This file contains the run based labelling pass and the moment maths for
+ * the blob analyser. See blobs.h for how it works.
+ */
+#include "blobs.h"
+#include <string.h>
+#include <math.h>
+
+double Blob::majorVariance() const {
+	double n = area;
+	double cx = sumX / n, cy = sumY / n;
+	double cxx = sumXX / n - cx * cx, cyy = sumYY / n - cy * cy, cxy = sumXY / n - cx * cy;
+	double half = (cxx + cyy) / 2, diff = (cxx - cyy) / 2;
+	//+1/12 is the variance of a unit pixel, so a single pixel is not a point
+	return half + sqrt(diff * diff + cxy * cxy) + 1.0 / 12;
+}
+
+float Blob::radius() const {
+	return float(2 * sqrt(majorVariance()));
+}
+
+double Blob::roundness() const {
+	return area / (3.1415926 * 4 * majorVariance());
+}
+
+/*
+ * sums over x = x0..x1 in closed form so a run costs the same however long it is
+ */
+void Blob::addRun(int y, int x0, int x1) {
+	int64 n = x1 - x0 + 1;
+	int64 sx = (int64)(x0 + x1) * n / 2;
+	int64 sxx = ((int64)x1 * (x1 + 1) * (2 * x1 + 1) - (int64)(x0 - 1) * x0 * (2 * x0 - 1)) / 6;
+	area += (int)n;
+	sumX += sx;
+	sumY += n * y;
+	sumXX += sxx;
+	sumYY += n * y * y;
+	sumXY += sx * y;
+	if (x0 < minX) minX = x0;
+	if (x1 > maxX) maxX = x1;
+	if (y < minY) minY = y;
+	if (y > maxY) maxY = y;
+}
+
+void Blob::add(const Blob &other) {
+	area += other.area;
+	sumX += other.sumX;
+	sumY += other.sumY;
+	sumXX += other.sumXX;
+	sumYY += other.sumYY;
+	sumXY += other.sumXY;
+	minX = min(minX, other.minX);
+	minY = min(minY, other.minY);
+	maxX = max(maxX, other.maxX);
+	maxY = max(maxY, other.maxY);
+	if (other.first.y < first.y || (other.first.y == first.y && other.first.x < first.x))
+		first = other.first;
+}
+
+void Blob::shift(Point offset) {
+	int64 dx = offset.x, dy = offset.y;
+	//the cross and square terms need the old first order sums, so they go first
+	sumXY += dy * sumX + dx * sumY + dx * dy * area;
+	sumXX += 2 * dx * sumX + dx * dx * area;
+	sumYY += 2 * dy * sumY + dy * dy * area;
+	sumX += dx * area;
+	sumY += dy * area;
+	minX += offset.x;
+	maxX += offset.x;
+	minY += offset.y;
+	maxY += offset.y;
+	first += offset;
+}
+
+int BlobAnalyser::newLabel(int y, int x0) {
+	Blob b;
+	b.area = 0;
+	b.sumX = b.sumY = b.sumXX = b.sumYY = b.sumXY = 0;
+	b.minX = b.maxX = x0;
+	b.minY = b.maxY = y;
+	b.first = Point(x0, y);
+	labelStats.push_back(b);
+	parent.push_back((int)parent.size());
+	return (int)parent.size() - 1;
+}
+
+int BlobAnalyser::find(int label) {
+	while (parent[label] != label) {
+		parent[label] = parent[parent[label]];
+		label = parent[label];
+	}
+	return label;
+}
+
+/*
+ * the smaller label always becomes the root. Labels are made in raster order,
+ * so the root is the part of the blob that was seen first
+ */
+int BlobAnalyser::join(int a, int b) {
+	a = find(a);
+	b = find(b);
+	if (a < b) {
+		parent[b] = a;
+		return a;
+	}
+	parent[a] = b;
+	return b;
+}
+
+/*
+ * cuts one row into runs, skipping empty stretches 8 pixels at a time
+ */
+void BlobAnalyser::scanRow(const uchar *row, int cols, vector<BlobRun> &out) {
+	out.clear();
+	int x = 0;
+	while (x < cols) {
+		while (x + 8 <= cols) {
+			uint64 word;
+			memcpy(&word, row + x, 8);
+			if (word != 0)
+				break;
+			x += 8;
+		}
+		while (x < cols && row[x] == 0)
+			x++;
+		if (x >= cols)
+			break;
+		BlobRun run;
+		run.x0 = x;
+		while (x < cols && row[x] != 0)
+			x++;
+		run.x1 = x - 1;
+		run.label = -1;
+		out.push_back(run);
+	}
+}
+
+void BlobAnalyser::analyse(const Mat &mask, vector<Blob> &blobs) {
+	labelRows(mask, 0, mask.rows, blobs, 0);
+}
+
+void BlobAnalyser::analyseRows(const Mat &mask, int rowStart, int rowEnd, vector<Blob> &blobs) {
+	labelRows(mask, rowStart, rowEnd, blobs, 0);
+}
+
+bool BlobAnalyser::analyse(const Mat &mask, vector<Blob> &blobs, int blobLimit) {
+	return labelRows(mask, 0, mask.rows, blobs, max(blobLimit, 1));
+}
+
+/*
+ * blobLimit 0 for no limit
+ */
+bool BlobAnalyser::labelRows(const Mat &mask, int rowStart, int rowEnd, vector<Blob> &blobs, int blobLimit) {
+	CV_Assert(mask.type() == CV_8UC1 && rowStart >= 0 && rowEnd <= mask.rows);
+	labelStats.clear();
+	parent.clear();
+	prevRuns.clear();
+	firstRuns.clear();
+	blobs.clear();
+	lastRow.clear();
+	int finished = 0;
+
+	for (int y = rowStart; y < rowEnd; y++) {
+		scanRow(mask.ptr<uchar>(y), mask.cols, curRuns);
+
+		//both run lists are sorted by x, walk them together
+		size_t p = 0;
+		for (size_t i = 0; i < curRuns.size(); i++) {
+			BlobRun &run = curRuns[i];
+			//8-connected: a run above touches if it reaches x0-1..x1+1
+			while (p < prevRuns.size() && prevRuns[p].x1 < run.x0 - 1)
+				p++;
+			int label = -1;
+			for (size_t q = p; q < prevRuns.size() && prevRuns[q].x0 <= run.x1 + 1; q++)
+				label = label < 0 ? find(prevRuns[q].label) : join(label, prevRuns[q].label);
+			if (label < 0)
+				label = newLabel(y, run.x0);
+			run.label = label;
+			labelStats[label].addRun(y, run.x0, run.x1);
+		}
+		if (y == rowStart)
+			firstRuns = curRuns;
+
+		if (blobLimit > 0) {
+			//roots with a run in this row can still grow, the ones left behind above can't
+			lastRow.resize(parent.size(), -1);
+			for (size_t i = 0; i < curRuns.size(); i++)
+				lastRow[find(curRuns[i].label)] = y;
+			for (size_t i = 0; i < prevRuns.size(); i++) {
+				int root = find(prevRuns[i].label);
+				if (lastRow[root] == y - 1) {
+					lastRow[root] = -2; //counted
+					++finished;
+				}
+			}
+			if (finished >= blobLimit) {
+				prevRuns.clear();
+				firstRuns.clear();
+				return false;
+			}
+		}
+		prevRuns.swap(curRuns);
+	}
+	if (blobLimit > 0 && (int)parent.size() >= blobLimit) {
+		int roots = 0;
+		for (int i = 0; i < (int)parent.size(); i++)
+			roots += parent[i] == i;
+		if (roots >= blobLimit) {
+			prevRuns.clear();
+			firstRuns.clear();
+			return false;
+		}
+	}
+
+	//roots are never larger than their children, so one ascending pass folds every label into its root
+	blobIndex.resize(parent.size());
+	for (int i = 0; i < (int)parent.size(); i++) {
+		int root = find(i);
+		if (root != i) {
+			blobs[blobIndex[root]].add(labelStats[i]);
+		} else {
+			blobIndex[i] = (int)blobs.size();
+			blobs.push_back(labelStats[i]);
+		}
+	}
+	for (size_t i = 0; i < firstRuns.size(); i++)
+		firstRuns[i].label = blobIndex[find(firstRuns[i].label)];
+	for (size_t i = 0; i < prevRuns.size(); i++)
+		prevRuns[i].label = blobIndex[find(prevRuns[i].label)];
+	return true;
+}
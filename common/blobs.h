@@ -0,0 +1,94 @@
+/*
+ * Blob analyser header file
+ * Description:
+ * Connected component labelling of a binary mask in one raster pass. Each row
+ * is cut into runs of set pixels, runs that touch a run in the row above
+ * (8-connected, like findContours) are joined with union-find, and the area,
+ * bounding box and first/second order moments of every run are added to its
+ * label as it is found. No contour vectors are built, the cost is one read of
+ * every pixel plus a little work per run, however many blobs the frame has.
+ *
+ * Roundness comes from the moments: the largest eigenvalue of the pixel
+ * covariance gives the major axis of the ellipse with the same moments, and
+ * roundness is the area over the area of the circle around that axis. That is
+ * 1 for a disk and minor/major for an ellipse, the same thing the old
+ * contourArea / minEnclosingCircle ratio measured.
+ *
+ * Note:
+ * - Keep one BlobAnalyser per thread and reuse it. The run and label buffers
+ *   keep their size between frames so nothing is allocated after the first
+ *   few frames.
+ * - Holes are not filled, a blob's area only counts its set pixels.
+ * - Blobs come out in raster order of their first pixel.
+ * - analyseRows() labels a band of rows on its own and keeps the runs of its
+ *   first and last row, so bands done on different threads can be joined
+ *   afterwards (see balloonDetector.h).
+ * - With a blob limit the pass stops as soon as that many blobs are certain:
+ *   a blob with no run in the row just labelled can't grow or join another
+ *   one, so it is counted as finished. A noisy mask costs the rows up to the
+ *   limit'th finished blob instead of a whole pass.
+ */
+#ifndef BLOBS_INCLUDED
+#define BLOBS_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+struct Blob {
+	int area;
+	int64 sumX, sumY, sumXX, sumYY, sumXY;
+	int minX, minY, maxX, maxY;
+	Point first; //first pixel in raster order
+
+	Point2f centroid() const { return Point2f(float(double(sumX) / area), float(double(sumY) / area)); }
+	Rect bounds() const { return Rect(minX, minY, maxX - minX + 1, maxY - minY + 1); }
+	//variance of the pixels along the major axis
+	double majorVariance() const;
+	//radius of the circle around the major axis of the equivalent ellipse
+	float radius() const;
+	//area / (pi * radius^2), 1 for a disk
+	double roundness() const;
+
+	void addRun(int y, int x0, int x1);
+	void add(const Blob &other);
+	//moves the blob by offset, for blobs found in a sub image
+	void shift(Point offset);
+};
+
+//one horizontal run of set pixels, x1 is inclusive
+struct BlobRun {
+	int x0, x1;
+	int label;
+};
+
+class BlobAnalyser {
+public:
+	BlobAnalyser() {}
+
+	//labels the non zero pixels of a CV_8UC1 mask
+	void analyse(const Mat &mask, vector<Blob> &blobs);
+	//same for rows [rowStart, rowEnd) only
+	void analyseRows(const Mat &mask, int rowStart, int rowEnd, vector<Blob> &blobs);
+	//false, with blobs empty, as soon as the mask certainly has blobLimit blobs or more
+	bool analyse(const Mat &mask, vector<Blob> &blobs, int blobLimit);
+
+	//runs of the first and last row of the last analyse, label is the index in blobs
+	const vector<BlobRun> &firstRowRuns() const { return firstRuns; }
+	const vector<BlobRun> &lastRowRuns() const { return prevRuns; }
+
+private:
+	int newLabel(int y, int x0);
+	int find(int label);
+	int join(int a, int b);
+	void scanRow(const uchar *row, int cols, vector<BlobRun> &out);
+	bool labelRows(const Mat &mask, int rowStart, int rowEnd, vector<Blob> &blobs, int blobLimit);
+
+	vector<BlobRun> prevRuns, curRuns, firstRuns;
+	vector<Blob> labelStats;
+	vector<int> parent;
+	vector<int> blobIndex;
+	vector<int> lastRow;     //last row each root had a run in, only kept with a blob limit
+};
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Integral image CamShift
+ * Description:
+ * Summed area tables, the O(1) mean shift and the fixed point box fit. See
+ * camShift.h.
+ */
+#include "camShift.h"
+#include <math.h>
+
+/*
+ * num / den rounded to the nearest integer, ties away from zero. den > 0
+ */
+static inline int64_t roundDiv(int64_t num, int64_t den) {
+	return num >= 0 ? (num + den / 2) / den : -((-num + den / 2) / den);
+}
+
+static uint64_t isqrt(uint64_t v) {
+	uint64_t r = (uint64_t)sqrt((double)v);
+	//the double square root can be one off either way for large v
+	while (r * r > v)
+		r--;
+	while ((r + 1) * (r + 1) <= v)
+		r++;
+	return r;
+}
+
+void IntegralCamShift::setImage(const Mat &backproj) {
+	CV_Assert(backproj.type() == CV_8UC1);
+	image = backproj;
+	cols = backproj.cols;
+	rows = backproj.rows;
+	size_t stride = cols + 1;
+	size_t n = stride * (rows + 1);
+	sumP.resize(n);
+	sumXP.resize(n);
+	sumYP.resize(n);
+	for (int x = 0; x <= cols; x++) {
+		sumP[x] = 0;
+		sumXP[x] = sumYP[x] = 0;
+	}
+
+	for (int y = 0; y < rows; y++) {
+		const uchar *p = backproj.ptr<uchar>(y);
+		size_t above = y * stride, at = above + stride;
+		sumP[at] = 0;
+		sumXP[at] = sumYP[at] = 0;
+		//running sums of this row added to the table row above
+		uint32_t rowP = 0;
+		uint64_t rowXP = 0;
+		for (int x = 0; x < cols; x++) {
+			rowP += p[x];
+			rowXP += (uint32_t)x * p[x];
+			sumP[at + x + 1] = sumP[above + x + 1] + rowP;
+			sumXP[at + x + 1] = sumXP[above + x + 1] + rowXP;
+			sumYP[at + x + 1] = sumYP[above + x + 1] + (uint64_t)y * rowP;
+		}
+	}
+}
+
+WindowMoments IntegralCamShift::moments(Rect r) const {
+	size_t stride = cols + 1;
+	size_t a = r.y * stride + r.x, b = a + r.width, c = a + r.height * stride, d = c + r.width;
+	WindowMoments m;
+	m.m00 = int64_t(sumP[d]) - sumP[b] - sumP[c] + sumP[a];
+	//the tables hold moments about the image origin, move them to the rectangle's corner
+	m.m10 = int64_t(sumXP[d] - sumXP[b] - sumXP[c] + sumXP[a]) - int64_t(r.x) * m.m00;
+	m.m01 = int64_t(sumYP[d] - sumYP[b] - sumYP[c] + sumYP[a]) - int64_t(r.y) * m.m00;
+	return m;
+}
+
+int IntegralCamShift::meanShift(Rect &window, int maxIterations) const {
+	Rect imageRect(0, 0, cols, rows);
+	window &= imageRect;
+	if (window.area() == 0)
+		window = Rect(cols / 2, rows / 2, 1, 1) & imageRect;
+	if (window.area() == 0)
+		return 0;
+
+	Point before(-1, -1);
+	int i = 0;
+	while (i < maxIterations) {
+		WindowMoments m = moments(window);
+		if (m.m00 == 0)
+			break;
+		//centroid minus the window centre, in whole pixels
+		int dx = (int)roundDiv(2 * m.m10 - m.m00 * window.width, 2 * m.m00);
+		int dy = (int)roundDiv(2 * m.m01 - m.m00 * window.height, 2 * m.m00);
+		int nx = min(max(window.x + dx, 0), cols - window.width);
+		int ny = min(max(window.y + dy, 0), rows - window.height);
+		if (nx == window.x && ny == window.y)
+			break;
+		i++;
+		//rounding can leave it stepping back and forth between two spots, either will do
+		bool back = nx == before.x && ny == before.y;
+		before = window.tl();
+		window.x = nx;
+		window.y = ny;
+		if (back)
+			break;
+	}
+	return i;
+}
+
+RotatedRect IntegralCamShift::track(Rect &window, int maxIterations) {
+	nIterations = meanShift(window, maxIterations);
+	if (window.area() == 0)
+		return RotatedRect();
+
+	Rect r(window.x - CAMSHIFT_TOLERANCE, window.y - CAMSHIFT_TOLERANCE,
+			window.width + 2 * CAMSHIFT_TOLERANCE, window.height + 2 * CAMSHIFT_TOLERANCE);
+	r &= Rect(0, 0, cols, rows);
+	WindowMoments m = moments(r);
+	if (m.m00 == 0) {
+		window = Rect(window.x + window.width / 2, window.y + window.height / 2, 0, 0);
+		return RotatedRect();
+	}
+
+	//second moments about the centroid, pixel offsets in 1/16 pixels so a sum is exact in 64 bits
+	const int one = 1 << CAMSHIFT_FRACTION_BITS;
+	int64_t cx = roundDiv(m.m10 * one, m.m00), cy = roundDiv(m.m01 * one, m.m00);
+	int64_t sxx = 0, syy = 0, sxy = 0;
+	for (int y = 0; y < r.height; y++) {
+		const uchar *p = image.ptr<uchar>(r.y + y) + r.x;
+		int32_t dy = int32_t(y * one - cy);
+		int64_t rowXX = 0, rowXY = 0;
+		int32_t rowP = 0;
+		for (int x = 0; x < r.width; x++) {
+			if (!p[x])
+				continue;
+			int32_t pdx = p[x] * int32_t(x * one - cx);
+			rowXX += int64_t(pdx) * int32_t(x * one - cx);
+			rowXY += pdx;
+			rowP += p[x];
+		}
+		sxx += rowXX;
+		sxy += rowXY * dy;
+		syy += int64_t(rowP) * dy * dy;
+	}
+
+	//covariance in 1/256 pixel^2, its eigen values are the squared half axes over 4
+	int64_t a = sxx / m.m00, b = sxy / m.m00, c = syy / m.m00;
+	int64_t half = (a + c) / 2, diff = (a - c) / 2;
+	int64_t root = (int64_t)isqrt(uint64_t(diff * diff + b * b));
+	int64_t major = max(half + root, int64_t(0)), minor = max(half - root, int64_t(0));
+	//4 sigma in pixels: 4 * sqrt(v / 256) = sqrt(16 v) / 16
+	float length = float(isqrt(uint64_t(16 * major))) / one;
+	float width = float(isqrt(uint64_t(16 * minor))) / one;
+
+	//from here on it is a few operations a frame, cv::CamShift's bounding box in floats
+	//diff + root is 0 only for an upright ellipse, where atan2(0, 0) would lay it flat
+	double theta = diff + root == 0 ? CV_PI * 0.5 : atan2((double)b, (double)(diff + root));
+	double cs = cos(theta), sn = sin(theta);
+	int xc = int(roundDiv(m.m10, m.m00)) + r.x, yc = int(roundDiv(m.m01, m.m00)) + r.y;
+
+	int t0 = cvRound(fabs(length * cs)), t1 = cvRound(fabs(width * sn));
+	t0 = max(t0, t1) + 2;
+	window.width = min(t0, (cols - xc) * 2);
+	t1 = cvRound(fabs(length * sn));
+	t0 = cvRound(fabs(width * cs));
+	t1 = max(t1, t0) + 2;
+	window.height = min(t1, (rows - yc) * 2);
+	window.x = max(0, xc - window.width / 2);
+	window.y = max(0, yc - window.height / 2);
+	window.width = min(cols - window.x, window.width);
+	window.height = min(rows - window.y, window.height);
+
+	RotatedRect box;
+	box.size = Size2f(width, length);
+	box.center = Point2f(window.x + window.width * 0.5f, window.y + window.height * 0.5f);
+	float angle = float((CV_PI * 0.5 + theta) * 180 / CV_PI);
+	while (angle < 0)
+		angle += 360;
+	while (angle >= 360)
+		angle -= 360;
+	if (angle >= 180)
+		angle -= 180;
+	box.angle = angle;
+	return box;
+}
@@ -0,0 +1,85 @@
+/*
+ * Integral image CamShift header file
+ * Description:
+ * A CamShift that pays for the back projection once per frame instead of
+ * once per mean shift iteration. cv::CamShift rescans the whole window for
+ * its moments on every iteration, so ten iterations cost ten scans.
+ *
+ * setImage() builds summed area tables of p, x*p and y*p over the back
+ * projection in one pass. After that the zeroth and first moments of any
+ * rectangle are four reads per table, and a mean shift iteration is O(1)
+ * whatever the size of the window. That makes iterating until the window
+ * stops moving cheap, where cv::CamShift is usually stopped after 10.
+ *
+ * The orientation and size are fitted like cv::CamShift does: second
+ * moments over the converged window grown by CAMSHIFT_TOLERANCE on every
+ * side, and a box from their eigen vectors. The moments are summed in
+ * integers about the centroid in 1/16 pixel fixed point, and the eigen
+ * values come from an integer square root. Only the angle and the
+ * bounding box of the fitted ellipse are floating point, a handful of
+ * operations per frame.
+ *
+ * Usage:
+ *    IntegralCamShift camShift;
+ *    camShift.setImage(backproj);
+ *    RotatedRect box = camShift.track(window);   //window is moved like cv::CamShift moves it
+ *    if (window.area() <= 1) ...lost
+ *
+ * Note:
+ * - backproj has to be CV_8UC1. The tables are kept between frames, so a
+ *   tracker that keeps its IntegralCamShift doesn't reallocate them.
+ * - Several windows can be tracked in one back projection with one
+ *   setImage() and a track() each.
+ * - Rounding ties go away from zero (cvRound rounds them to even), so a
+ *   window can end up a pixel away from where cv::CamShift leaves it.
+ * - When there is nothing under the window at all the box is empty and the
+ *   window is shrunk to nothing where it was, so area() <= 1 means lost
+ *   like it does for cv::CamShift.
+ */
+#ifndef CAM_SHIFT_INCLUDED
+#define CAM_SHIFT_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+using namespace cv;
+
+const int CAMSHIFT_MAX_ITERATIONS = 50;
+//pixels the converged window grows by on every side before the box is fitted, as in cv::CamShift
+const int CAMSHIFT_TOLERANCE = 10;
+//fraction bits of the fixed point centroid the second moments are taken about
+const int CAMSHIFT_FRACTION_BITS = 4;
+
+//zeroth and first moments of a rectangle, first moments about its top left corner
+struct WindowMoments {
+	int64_t m00, m10, m01;
+};
+
+class IntegralCamShift {
+public:
+	IntegralCamShift() : cols(0), rows(0), nIterations(0) {}
+
+	//the summed area tables of backproj, once per frame. backproj is kept (not copied) for the box fit
+	void setImage(const Mat &backproj);
+	Size size() const { return Size(cols, rows); }
+
+	//O(1) moments of r, which has to lie inside the image
+	WindowMoments moments(Rect r) const;
+	//moves window until it stops (at most maxIterations steps), like cv::meanShift. Returns the steps taken
+	int meanShift(Rect &window, int maxIterations = CAMSHIFT_MAX_ITERATIONS) const;
+	//mean shift, then the fitted box. window becomes the box's bounding rectangle, like cv::CamShift
+	RotatedRect track(Rect &window, int maxIterations = CAMSHIFT_MAX_ITERATIONS);
+
+	//mean shift steps of the last track()
+	int iterations() const { return nIterations; }
+
+private:
+	Mat image;
+	int cols, rows;
+	//(rows + 1) x (cols + 1), the first row and column are zero
+	vector<uint32_t> sumP;
+	vector<uint64_t> sumXP, sumYP;
+	int nIterations;
+};
+#endif
@@ -0,0 +1,140 @@
+/*
+ * CamShift targets
+ * Description:
+ * Search areas, the shared conversion and the per target tracking. See
+ * camShiftTargets.h.
+ */
+#include "camShiftTargets.h"
+#include <opencv2/imgproc/imgproc.hpp>
+
+Rect searchWindow(Rect window, int lostFrames, Size frame) {
+	int scale = 1 << min(lostFrames, 12);
+	int mx = max(cvRound(window.width * SEARCH_MARGIN), SEARCH_MIN_MARGIN) * scale;
+	int my = max(cvRound(window.height * SEARCH_MARGIN), SEARCH_MIN_MARGIN) * scale;
+	return Rect(window.x - mx, window.y - my, window.width + 2 * mx, window.height + 2 * my) &
+			Rect(0, 0, frame.width, frame.height);
+}
+
+CamShiftTargets::CamShiftTargets(int hueBins, int satBins, int threads) : hueBins(hueBins), satBins(satBins),
+		pool(threads), nextId(0), adaptive(true) {
+}
+
+int CamShiftTargets::add(const Mat &frame, int64 stamp, Rect selection, const HsvGate &gate) {
+	selection &= Rect(0, 0, frame.cols, frame.rows);
+	CV_Assert(selection.area() > 0);
+	Mat selHsv;
+	cvtColor(frame(selection), selHsv, COLOR_BGR2HSV);
+
+	list.push_back(CamShiftTarget());
+	CamShiftTarget &target = list.back();
+	target.id = nextId++;
+	target.model = HueSatHistogram(hueBins, satBins);
+	target.model.build(selHsv, HsvKeys(gate));
+	target.window = selection;
+	target.lostFrames = 0;
+	target.search = selection;
+	Point centre(selection.x + selection.width / 2, selection.y + selection.height / 2);
+	target.kalman.init(centre, TARGET_PROCESS_NOISE, TARGET_MEASUREMENT_NOISE, TARGET_VELOCITY_VARIANCE);
+	target.stamp = stamp;
+	target.measured = target.estimated = centre;
+	target.fill = 0;
+	target.modelUpdates = 0;
+	return target.id;
+}
+
+void CamShiftTargets::remove(int id) {
+	for (size_t i = 0; i < list.size(); i++) {
+		if (list[i].id == id) {
+			list.erase(list.begin() + i);
+			return;
+		}
+	}
+}
+
+void CamShiftTargets::track(CamShiftTarget &target) {
+	target.model.backProject(hsv(target.search), keys, target.backproj);
+
+	Rect window = target.window - target.search.tl(); //camshift works in the search area's coordinates
+	target.camShift.setImage(target.backproj);
+	target.box = target.camShift.track(window);
+	target.box.center += Point2f(target.search.tl());
+	target.fill = 0;
+	if (window.area() <= 1) {
+		//lost: keep the last window and look further around it next frame
+		target.lostFrames++;
+	} else {
+		target.fill = target.camShift.moments(window).m00 / (255.0f * window.area());
+		target.window = window + target.search.tl();
+		target.lostFrames = 0;
+		if (adaptive)
+			adapt(target);
+	}
+
+	if (target.found()) {
+		target.measured = target.box.center;
+		target.kalman.correct(target.box.center);
+	}
+	target.estimated = target.kalman.position();
+}
+
+/*
+ * Blends the middle of the window into the model when the frame passes the
+ * guards in camShiftTargets.h
+ */
+void CamShiftTargets::adapt(CamShiftTarget &target) {
+	if (target.fill < MODEL_MIN_FILL)
+		return;
+	Rect w = target.window;
+	int mx = cvRound(w.width * (1 - MODEL_WINDOW_SHARE) * 0.5f), my = cvRound(w.height * (1 - MODEL_WINDOW_SHARE) * 0.5f);
+	Rect middle(w.x + mx, w.y + my, w.width - 2 * mx, w.height - 2 * my);
+	if (middle.area() == 0)
+		return;
+	target.model.measure(hsv(middle), keys, target.windowBins);
+	if (target.model.similarity(target.windowBins) < MODEL_MIN_SIMILARITY)
+		return;
+	target.model.blend(target.windowBins, MODEL_UPDATE_RATE);
+	target.modelUpdates++;
+}
+
+void CamShiftTargets::update(const Mat &frame, int64 stamp, const HsvGate &gate, bool predict) {
+	CV_Assert(frame.type() == CV_8UC3);
+	regions.clear();
+	for (size_t i = 0; i < list.size(); i++) {
+		CamShiftTarget &target = list[i];
+		target.kalman.predict(float(stamp - target.stamp) / 1000000);
+		target.stamp = stamp;
+		if (predict) {
+			//the last window, moved to where the filter expects it across however long the frame gap was
+			Point2f p = target.kalman.position();
+			target.window.x = min(max(cvRound(p.x - target.window.width * 0.5f), 0), frame.cols - target.window.width);
+			target.window.y = min(max(cvRound(p.y - target.window.height * 0.5f), 0), frame.rows - target.window.height);
+		}
+		target.search = searchWindow(target.window, target.lostFrames, frame.size());
+		regions.push_back(target.search);
+	}
+	//merge until nothing overlaps, so every pixel is converted once and regions can be written in parallel
+	for (bool merged = true; merged;) {
+		merged = false;
+		for (size_t i = 0; i < regions.size() && !merged; i++) {
+			for (size_t j = i + 1; j < regions.size(); j++) {
+				if ((regions[i] & regions[j]).area() > 0) {
+					regions[i] |= regions[j];
+					regions.erase(regions.begin() + j);
+					merged = true;
+					break;
+				}
+			}
+		}
+	}
+
+	keys.build(gate);
+	hsv.create(frame.size(), CV_8UC3);
+	pool.parallelFor((int)regions.size(), [&](int i) {
+		//the area already has the right size and type, so it is written in place
+		Mat hsvArea = hsv(regions[i]);
+		cvtColor(frame(regions[i]), hsvArea, COLOR_BGR2HSV);
+	});
+	pool.parallelFor((int)list.size(), [&](int i) {
+		track(list[i]);
+	});
+}
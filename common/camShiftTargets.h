@@ -0,0 +1,129 @@
+/*
+ * CamShift targets header file
+ * Description:
+ * Tracks any number of objects with CamShift at once. Every target has its
+ * own hue x saturation histogram, window, search area and Kalman filter;
+ * what they share is the colour conversion.
+ *
+ * update() works out every target's search area first (the window and a
+ * margin around it, growing while the target is lost), merges the areas
+ * that overlap and converts only those to HSV, once, into a plane the size
+ * of the frame. The merged areas don't overlap so they are converted in
+ * parallel. Then the targets are tracked in parallel, each back projecting
+ * its histogram over its own search area of the shared plane, gate included,
+ * in one pass (see hueSatHistogram.h) and running an IntegralCamShift on
+ * that. Another target costs its search area and its back projection, the
+ * frame is never converted whole unless a lost target's search has grown to
+ * cover it.
+ *
+ * Every target's constant velocity Kalman filter (kalman.h) runs every
+ * frame with the time between the capture stamps. When update() is told to
+ * use the prediction, the search and camshift start from where the filter
+ * expects the target rather than where it was last seen, so a fast target
+ * or one across dropped frames is still inside the search area.
+ *
+ * Each target's colour model adapts (see hueSatHistogram.h) while it is
+ * tracked with confidence: camshift found it, the back projection fills at
+ * least MODEL_MIN_FILL of the window it settled on, and the colours in the
+ * middle of that window are at least MODEL_MIN_SIMILARITY like the
+ * model's. Then the middle of the window is blended in at
+ * MODEL_UPDATE_RATE, which only costs reading that window once. A frame that
+ * fails any of them leaves the model alone, so it doesn't learn the
+ * background when the target is lost or half hidden.
+ *
+ * Usage:
+ *    CamShiftTargets targets;   //32 hue x 8 saturation bins
+ *    int id = targets.add(frame, stamp, selection, HsvGate(s_min, v_min, v_max));
+ *    targets.update(frame, stamp, HsvGate(s_min, v_min, v_max), kalman);
+ *    for (...) targets.targets()[i].box, .found(), .estimated
+ *
+ * Note:
+ * - Needs C++11 (-std=c++11 -pthread) for the thread pool.
+ * - A target's backproj is its search area's back projection, for display.
+ * - Targets keep their IntegralCamShift, so its tables aren't reallocated
+ *   every frame.
+ */
+#ifndef CAM_SHIFT_TARGETS_INCLUDED
+#define CAM_SHIFT_TARGETS_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "camShift.h"
+#include "hueSatHistogram.h"
+#include "kalman.h"
+#include "threadPool.h"
+
+using namespace std;
+using namespace cv;
+
+//search this much of a target's window size around it on every side, and at least SEARCH_MIN_MARGIN pixels
+const float SEARCH_MARGIN = 0.5f;
+const int SEARCH_MIN_MARGIN = 16;
+
+//target Kalman filters: random acceleration px^2/s^3, camshift centre variance px^2, starting velocity variance px^2/s^2
+const float TARGET_PROCESS_NOISE = 1e4f;
+const float TARGET_MEASUREMENT_NOISE = 4;
+const float TARGET_VELOCITY_VARIANCE = 1e4f;
+
+//colour model updates: blend rate per frame, and the confidence a frame needs to be blended in
+const float MODEL_UPDATE_RATE = 0.05f;
+const float MODEL_MIN_FILL = 0.35f;        //mean back projection over the window / 255
+const float MODEL_MIN_SIMILARITY = 0.6f;   //Bhattacharyya coefficient with the model
+//the middle of the window the model learns from, the corners of a round object's window are background
+const float MODEL_WINDOW_SHARE = 0.7f;
+
+struct CamShiftTarget {
+	int id;
+	HueSatHistogram model;  //colours of the selection
+	Rect window;            //where it was last found, frame coordinates
+	int lostFrames;         //frames in a row camshift lost it, widens the search
+	Rect search;            //what was looked at in the last update
+	RotatedRect box;        //camshift's fit in the last update, empty when lost
+	Mat backproj;           //the back projection of search
+	IntegralCamShift camShift;
+	ConstantVelocityKalman kalman;
+	int64 stamp;            //capture time of the last update
+	Point measured, estimated;
+	float fill;             //mean back projection / 255 over the window in the last update
+	int modelUpdates;       //frames blended into the colour model
+	Mat windowBins;         //histogram of the last window measured
+
+	bool found() const { return lostFrames == 0; }
+};
+
+class CamShiftTargets {
+public:
+	//hueBins x satBins per histogram, threads counts the calling thread and 0 uses every core
+	CamShiftTargets(int hueBins = 32, int satBins = 8, int threads = 0);
+
+	//histogram of the colours inside selection that pass gate. Returns the new target's id
+	int add(const Mat &frame, int64 stamp, Rect selection, const HsvGate &gate);
+	void remove(int id);
+	void clear() { list.clear(); }
+	//whether confidently tracked windows are blended into the colour models, on by default
+	void setAdaptive(bool on) { adaptive = on; }
+	bool isAdaptive() const { return adaptive; }
+
+	//one frame for every target, stamp in microseconds. predict: search where the Kalman filters expect the targets
+	void update(const Mat &frame, int64 stamp, const HsvGate &gate, bool predict);
+
+	const vector<CamShiftTarget> &targets() const { return list; }
+	//areas converted by the last update, they don't overlap
+	const vector<Rect> &converted() const { return regions; }
+
+private:
+	void track(CamShiftTarget &target);
+	void adapt(CamShiftTarget &target);
+
+	int hueBins, satBins;
+	ThreadPool pool;
+	int nextId;
+	bool adaptive;
+	vector<CamShiftTarget> list;
+	HsvKeys keys;            //the gate of the last update
+	Mat hsv;                 //frame sized, only valid inside regions
+	vector<Rect> regions;
+};
+
+//the window and its margin, doubled for every frame lost up to the whole frame
+Rect searchWindow(Rect window, int lostFrames, Size frame);
+#endif
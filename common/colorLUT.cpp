@@ -0,0 +1,292 @@
+/*
+ * Colour class lookup table
+ * Description:
+ * This file contains the table build and the one read per pixel classify
+ * passes for the colour lookup table. See colorLUT.h for how the table is laid out.
+ */
+#include "colorLUT.h"
+#include <algorithm>
+#include <math.h>
+
+ColorLUT::ColorLUT(int bits) : bits(bits), shift(8 - bits) {
+	CV_Assert(bits >= 1 && bits <= 8);
+	labelTable.assign((size_t)1 << (3 * bits), 0);
+}
+
+int ColorLUT::addRange(const string &name, Scalar lower, Scalar upper, int code) {
+	CV_Assert(targets.size() < (size_t)MAX_COLOR_TARGETS);
+	CV_Assert(code == CV_BGR2HSV || code == CV_RGB2HSV);
+	ColorTarget t;
+	t.name = name;
+	t.type = COLOR_TARGET_RANGE;
+	t.code = code;
+	t.lower = lower;
+	t.upper = upper;
+	targets.push_back(t);
+	return (int)targets.size() - 1;
+}
+
+int ColorLUT::addBalloonyness(const string &name, const BalloonynessParams &params) {
+	CV_Assert(targets.size() < (size_t)MAX_COLOR_TARGETS);
+	ColorTarget t;
+	t.name = name;
+	t.type = COLOR_TARGET_BALLOONYNESS;
+	t.code = CV_BGR2HSV;
+	t.balloon = params;
+	targets.push_back(t);
+	return (int)targets.size() - 1;
+}
+
+void ColorLUT::setRange(int target, Scalar lower, Scalar upper) {
+	CV_Assert(targets[target].type == COLOR_TARGET_RANGE);
+	targets[target].lower = lower;
+	targets[target].upper = upper;
+}
+
+void ColorLUT::setBalloonyness(int target, const BalloonynessParams &params) {
+	CV_Assert(targets[target].type == COLOR_TARGET_BALLOONYNESS);
+	targets[target].balloon = params;
+}
+
+/*
+ * the hsv of the colour is worked out once for each channel order the
+ * targets use, not once per target
+ */
+uchar ColorLUT::exactLabel(int b, int g, int r) const {
+	int h[2] = { 0, 0 }, s = 0, v = 0;
+	bool converted[2] = { false, false };
+	uchar label = 0;
+	for (size_t t = 0; t < targets.size(); t++) {
+		const ColorTarget &target = targets[t];
+		int rgb = target.code == CV_RGB2HSV;
+		if (!converted[rgb]) {
+			if (rgb)
+				bgrToHsv8u(r, g, b, h[1], s, v);
+			else
+				bgrToHsv8u(b, g, r, h[0], s, v);
+			converted[rgb] = true;
+		}
+		bool in;
+		if (target.type == COLOR_TARGET_BALLOONYNESS)
+			in = balloonynessHsScore(h[rgb], s, target.balloon) > target.balloon.threshold;
+		else
+			in = h[rgb] >= target.lower[0] && h[rgb] <= target.upper[0] &&
+					s >= target.lower[1] && s <= target.upper[1] &&
+					v >= target.lower[2] && v <= target.upper[2];
+		if (in)
+			label |= 1 << t;
+	}
+	return label;
+}
+
+/*
+ * hue of a colour with some chroma, before OpenCV's rounding, 0..180
+ */
+static float exactHue(int b, int g, int r) {
+	int v = max(b, max(g, r)), diff = v - min(b, min(g, r));
+	float h;
+	if (v == r)
+		h = 30.f * (g - b) / diff;
+	else if (v == g)
+		h = 60 + 30.f * (b - r) / diff;
+	else
+		h = 120 + 30.f * (r - g) / diff;
+	return h < 0 ? h + 180 : h;
+}
+
+/*
+ * Hues a box of colours can have, as the arc lo..hi (lo > hi when it wraps
+ * through 0), a step wider each way for OpenCV's rounding. The box mustn't
+ * touch the grey axis. Seen down the grey axis the box is a convex polygon
+ * around the axis, not over it, and hue only ever grows with the angle
+ * around it, so the extreme hues are the corners'
+ */
+static void hueArc(int b0, int g0, int r0, int b1, int g1, int r1, bool rgb, int &lo, int &hi) {
+	float h[8];
+	for (int i = 0; i < 8; i++) {
+		int b = i & 4 ? b1 : b0, g = i & 2 ? g1 : g0, r = i & 1 ? r1 : r0;
+		h[i] = rgb ? exactHue(r, g, b) : exactHue(b, g, r);
+	}
+	sort(h, h + 8);
+	//the arc is everything but the widest gap between neighbouring corner hues
+	int start = 0;
+	float gap = h[0] + 180 - h[7];
+	for (int i = 1; i < 8; i++) {
+		if (h[i] - h[i - 1] > gap) {
+			gap = h[i] - h[i - 1];
+			start = i;
+		}
+	}
+	lo = ((int)floorf(h[start]) - 1 + 180) % 180;
+	hi = ((int)ceilf(h[(start + 7) % 8]) + 1) % 180;
+}
+
+static bool arcInside(int lo, int hi, double h0, double h1) {
+	return lo <= hi ? lo >= h0 && hi <= h1 : h0 <= 0 && h1 >= 179;
+}
+
+static bool arcMisses(int lo, int hi, double h0, double h1) {
+	return lo <= hi ? hi < h0 || lo > h1 : hi < h0 && lo > h1;
+}
+
+/*
+ * Every cell gets the classes its colours share, COLOR_AMBIGUOUS when they
+ * don't all agree. Bounds on the hue, saturation and value of the cell
+ * settle most cells from the corners, only those a limit might run through
+ * have each of their colours checked
+ */
+void ColorLUT::build() {
+	int n = 1 << bits, side = 1 << shift;
+	//the smallest saturation each hue passes a balloonyness target with, 256 for none
+	vector<vector<int> > minSat(targets.size());
+	for (size_t t = 0; t < targets.size(); t++) {
+		if (targets[t].type != COLOR_TARGET_BALLOONYNESS)
+			continue;
+		minSat[t].assign(180, 256);
+		for (int h = 0; h < 180; h++) {
+			for (int sat = 0; sat < 256; sat++) {
+				if (balloonynessHsScore(h, sat, targets[t].balloon) > targets[t].balloon.threshold) {
+					minSat[t][h] = sat;
+					break;
+				}
+			}
+		}
+	}
+
+	uchar *cell = &labelTable[0];
+	for (int bq = 0; bq < n; bq++) {
+		for (int gq = 0; gq < n; gq++) {
+			for (int rq = 0; rq < n; rq++, cell++) {
+				int b0 = bq << shift, g0 = gq << shift, r0 = rq << shift;
+				int b1 = b0 + side - 1, g1 = g0 + side - 1, r1 = r0 + side - 1;
+				int vLo = max(b0, max(g0, r0)), vHi = max(b1, max(g1, r1));
+				int diffLo = max(0, vLo - min(b1, min(g1, r1))), diffHi = vHi - min(b0, min(g0, r0));
+				int sLo = vHi > 0 ? max(0, (int)floorf(255.f * diffLo / vHi) - 1) : 0;
+				int sHi = vLo > 0 ? min(255, (int)ceilf(255.f * diffHi / vLo) + 1) : 255;
+				//with a grey in the cell its hue could be anything
+				bool hueKnown = diffLo > 0;
+				int arc[2][2] = { { 0, 179 }, { 0, 179 } };
+				if (hueKnown) {
+					hueArc(b0, g0, r0, b1, g1, r1, false, arc[0][0], arc[0][1]);
+					hueArc(b0, g0, r0, b1, g1, r1, true, arc[1][0], arc[1][1]);
+				}
+
+				uchar label = 0;
+				bool settled = true;
+				for (size_t t = 0; t < targets.size() && settled; t++) {
+					const ColorTarget &target = targets[t];
+					int lo = arc[target.code == CV_RGB2HSV][0], hi = arc[target.code == CV_RGB2HSV][1];
+					if (target.type == COLOR_TARGET_BALLOONYNESS) {
+						int least = 256, most = 0;
+						for (int h = lo;; h = (h + 1) % 180) {
+							least = min(least, minSat[t][h]);
+							most = max(most, minSat[t][h]);
+							if (h == hi)
+								break;
+						}
+						if (sLo >= most)
+							label |= 1 << t;
+						else if (sHi >= least)
+							settled = false;
+					} else {
+						bool out = vHi < target.lower[2] || vLo > target.upper[2] ||
+								sHi < target.lower[1] || sLo > target.upper[1] ||
+								arcMisses(lo, hi, target.lower[0], target.upper[0]);
+						bool in = vLo >= target.lower[2] && vHi <= target.upper[2] &&
+								sLo >= target.lower[1] && sHi <= target.upper[1] &&
+								arcInside(lo, hi, target.lower[0], target.upper[0]);
+						if (in)
+							label |= 1 << t;
+						else if (!out)
+							settled = false;
+					}
+				}
+
+				if (!settled) {
+					label = exactLabel(b0, g0, r0);
+					for (int b = b0; b <= b1 && label != COLOR_AMBIGUOUS; b++)
+						for (int g = g0; g <= g1 && label != COLOR_AMBIGUOUS; g++)
+							for (int r = r0; r <= r1; r++)
+								if (exactLabel(b, g, r) != label) {
+									label = COLOR_AMBIGUOUS;
+									break;
+								}
+				}
+				*cell = label;
+			}
+		}
+	}
+}
+
+void ColorLUT::buildScore(const BalloonynessParams &params) {
+	int n = 1 << bits, half = shift > 0 ? 1 << (shift - 1) : 0;
+	scoreTable.resize(labelTable.size());
+	uchar *cell = &scoreTable[0];
+	for (int bq = 0; bq < n; bq++)
+		for (int gq = 0; gq < n; gq++)
+			for (int rq = 0; rq < n; rq++)
+				*cell++ = (uchar)balloonynessScore((bq << shift) + half, (gq << shift) + half, (rq << shift) + half, params);
+}
+
+static void lookupRows(const vector<uchar> &table, int bits, int shift, const Mat &bgr, Mat &out, int rowStart, int rowEnd) {
+	const uchar *tab = &table[0];
+	for (int y = rowStart; y < rowEnd; y++) {
+		const uchar *px = bgr.ptr<uchar>(y);
+		uchar *dst = out.ptr<uchar>(y);
+		for (int x = 0; x < bgr.cols; x++, px += 3)
+			dst[x] = tab[((px[0] >> shift) << (2 * bits)) | ((px[1] >> shift) << bits) | (px[2] >> shift)];
+	}
+}
+
+void ColorLUT::classify(const Mat &bgr, Mat &labels) const {
+	labels.create(bgr.size(), CV_8UC1);
+	classifyRows(bgr, labels, 0, bgr.rows);
+}
+
+void ColorLUT::classifyRows(const Mat &bgr, Mat &labels, int rowStart, int rowEnd) const {
+	CV_Assert(bgr.type() == CV_8UC3 && labels.type() == CV_8UC1 && labels.size() == bgr.size());
+	const uchar *tab = &labelTable[0];
+	for (int y = rowStart; y < rowEnd; y++) {
+		const uchar *px = bgr.ptr<uchar>(y);
+		uchar *dst = labels.ptr<uchar>(y);
+		for (int x = 0; x < bgr.cols; x++, px += 3) {
+			uchar label = tab[index(px[0], px[1], px[2])];
+			dst[x] = label & COLOR_AMBIGUOUS ? exactLabel(px[0], px[1], px[2]) : label;
+		}
+	}
+}
+
+void ColorLUT::mask(const Mat &bgr, int target, Mat &dst) const {
+	CV_Assert(bgr.type() == CV_8UC3);
+	dst.create(bgr.size(), CV_8UC1);
+	const uchar *tab = &labelTable[0];
+	const uchar bit = 1 << target;
+	for (int y = 0; y < bgr.rows; y++) {
+		const uchar *px = bgr.ptr<uchar>(y);
+		uchar *out = dst.ptr<uchar>(y);
+		for (int x = 0; x < bgr.cols; x++, px += 3) {
+			uchar label = tab[index(px[0], px[1], px[2])];
+			if (label & COLOR_AMBIGUOUS)
+				label = exactLabel(px[0], px[1], px[2]);
+			out[x] = (label & bit) ? 255 : 0;
+		}
+	}
+}
+
+void ColorLUT::score(const Mat &bgr, Mat &dst) const {
+	CV_Assert(bgr.type() == CV_8UC3 && !scoreTable.empty());
+	dst.create(bgr.size(), CV_8UC1);
+	lookupRows(scoreTable, bits, shift, bgr, dst, 0, bgr.rows);
+}
+
+void ColorLUT::extract(const Mat &labels, int target, Mat &dst) {
+	CV_Assert(labels.type() == CV_8UC1);
+	dst.create(labels.size(), CV_8UC1);
+	const uchar bit = 1 << target;
+	for (int y = 0; y < labels.rows; y++) {
+		const uchar *src = labels.ptr<uchar>(y);
+		uchar *out = dst.ptr<uchar>(y);
+		for (int x = 0; x < labels.cols; x++)
+			out[x] = (src[x] & bit) ? 255 : 0;
+	}
+}
@@ -0,0 +1,99 @@
+/*
+ * Colour class lookup table header file
+ * Description:
+ * Maps a BGR pixel straight to the set of target colours it belongs to with
+ * a single table read. The table is indexed by the top `bits` bits of each
+ * channel (6 bits -> 64x64x64 = 256KB, small enough to stay in cache) and
+ * holds one bit per target, so one pass over a frame labels every target at
+ * once and adding a target does not add a pass.
+ *
+ * Targets are either an inclusive HSV range (what inRange does) or the
+ * balloonyness score from balloonyness.h. A second table can hold the
+ * balloonyness score itself for display.
+ *
+ * A cell whose colours don't all get the same classes, one a range limit or
+ * the balloonyness threshold runs through, holds COLOR_AMBIGUOUS instead and
+ * its pixels are classified exactly. Only the colours on a limit pay for the
+ * conversion, so the small table still gives exactly what inRange would.
+ *
+ * Note:
+ * - build() settles most cells from bounds on their hue, saturation and
+ *   value and checks every colour of the rest, tens of ms per target. The
+ *   score table is still the colour in the centre of each cell.
+ * - Call build() after adding targets or changing ranges, it is not done
+ *   automatically so several changes only cost one rebuild.
+ */
+#ifndef COLOR_LUT_INCLUDED
+#define COLOR_LUT_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <string>
+#include <vector>
+#include "balloonyness.h"
+
+using namespace std;
+using namespace cv;
+
+//the top label bit marks an ambiguous cell, so one less target than a byte holds
+const int MAX_COLOR_TARGETS = 7;
+const uchar COLOR_AMBIGUOUS = 1 << MAX_COLOR_TARGETS;
+
+enum ColorTargetType {
+	COLOR_TARGET_RANGE,
+	COLOR_TARGET_BALLOONYNESS
+};
+
+struct ColorTarget {
+	string name;
+	int type;
+	int code;             //CV_BGR2HSV or CV_RGB2HSV, the space lower/upper are given in
+	Scalar lower, upper;  //inclusive hsv limits for COLOR_TARGET_RANGE
+	BalloonynessParams balloon;
+};
+
+class ColorLUT {
+public:
+	ColorLUT(int bits = 6);
+
+	//return the target index, which is also its bit in the label image
+	int addRange(const string &name, Scalar lower, Scalar upper, int code = CV_BGR2HSV);
+	int addBalloonyness(const string &name, const BalloonynessParams &params = BalloonynessParams());
+	void setRange(int target, Scalar lower, Scalar upper);
+	void setBalloonyness(int target, const BalloonynessParams &params);
+
+	int targetCount() const { return (int)targets.size(); }
+	const ColorTarget &target(int i) const { return targets[i]; }
+
+	//rebuild the label table from the current targets
+	void build();
+	//build the score table from the given balloonyness parameters
+	void buildScore(const BalloonynessParams &params = BalloonynessParams());
+
+	inline int index(int b, int g, int r) const {
+		return ((b >> shift) << (2 * bits)) | ((g >> shift) << bits) | (r >> shift);
+	}
+	inline uchar lookup(int b, int g, int r) const {
+		uchar label = labelTable[index(b, g, r)];
+		return label & COLOR_AMBIGUOUS ? exactLabel(b, g, r) : label;
+	}
+	//the classes of one colour without the table
+	uchar exactLabel(int b, int g, int r) const;
+
+	//labels: CV_8UC1, bit i set when the pixel belongs to target i
+	void classify(const Mat &bgr, Mat &labels) const;
+	void classifyRows(const Mat &bgr, Mat &labels, int rowStart, int rowEnd) const;
+	//mask: CV_8UC1, 255 where the pixel belongs to the target
+	void mask(const Mat &bgr, int target, Mat &dst) const;
+	//score: CV_8UC1 balloonyness score, needs buildScore()
+	void score(const Mat &bgr, Mat &dst) const;
+
+	//0/255 mask of one target from a label image made by classify()
+	static void extract(const Mat &labels, int target, Mat &dst);
+
+private:
+	int bits, shift;
+	vector<ColorTarget> targets;
+	vector<uchar> labelTable;
+	vector<uchar> scoreTable;
+};
+#endif
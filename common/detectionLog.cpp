@@ -0,0 +1,83 @@
+/*
+ * Detection stream
+ * Description:
+ * csv and binary record writing for the detection stream. See detectionLog.h
+ * for the formats.
+ */
+#include "detectionLog.h"
+
+void blobsToDetections(const vector<Blob> &blobs, double minRoundness, vector<Detection> &detections) {
+	detections.clear();
+	for (size_t i = 0; i < blobs.size(); i++) {
+		double roundness = blobs[i].roundness();
+		if (roundness < minRoundness)
+			continue;
+		Detection d;
+		d.center = blobs[i].centroid();
+		d.radius = blobs[i].radius();
+		d.roundness = (float)roundness;
+		d.area = blobs[i].area;
+		detections.push_back(d);
+	}
+}
+
+DetectionLog::DetectionLog() : file(NULL), toStdout(false), format(DETECTIONS_CSV) {
+}
+
+DetectionLog::~DetectionLog() {
+	close();
+}
+
+bool DetectionLog::open(const string &path, int format) {
+	close();
+	this->format = format;
+	toStdout = path == "-";
+	file = toStdout ? stdout : fopen(path.c_str(), format == DETECTIONS_BINARY ? "wb" : "w");
+	if (!file) {
+		perror(path.c_str());
+		return false;
+	}
+	if (format == DETECTIONS_CSV)
+		fprintf(file, "frame,timestamp_us,x,y,radius,roundness,area\n");
+	return true;
+}
+
+void DetectionLog::close() {
+	if (file && !toStdout)
+		fclose(file);
+	else if (file)
+		fflush(file);
+	file = NULL;
+}
+
+void DetectionLog::write(int frame, int64 timestampUs, const vector<Detection> &detections) {
+	if (!file)
+		return;
+
+	if (format == DETECTIONS_BINARY) {
+		DetectionFrameHeader header;
+		header.magic = DETECTION_FRAME_MAGIC;
+		header.frame = frame;
+		header.timestampUs = timestampUs;
+		header.count = (unsigned)detections.size();
+		fwrite(&header, sizeof(header), 1, file);
+		for (size_t i = 0; i < detections.size(); i++) {
+			DetectionRecord record;
+			record.x = detections[i].center.x;
+			record.y = detections[i].center.y;
+			record.radius = detections[i].radius;
+			record.roundness = detections[i].roundness;
+			record.area = detections[i].area;
+			fwrite(&record, sizeof(record), 1, file);
+		}
+	} else {
+		for (size_t i = 0; i < detections.size(); i++) {
+			const Detection &d = detections[i];
+			fprintf(file, "%d,%lld,%.2f,%.2f,%.2f,%.3f,%d\n", frame, (long long)timestampUs,
+					d.center.x, d.center.y, d.radius, d.roundness, d.area);
+		}
+	}
+
+	if (toStdout)
+		fflush(file);
+}
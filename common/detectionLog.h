@@ -0,0 +1,77 @@
+/*
+ * Detection stream header file
+ * Description:
+ * Writes the balloons found in every frame as structured records, so a
+ * headless run leaves something other than drawn pixels behind.
+ *
+ * csv: one line per balloon, after a header line
+ *    frame,timestamp_us,x,y,radius,roundness,area
+ * binary: per frame a DetectionFrameHeader followed by count DetectionRecords,
+ *    native byte order, no padding. Frames without balloons still get a header.
+ *
+ * Note:
+ * - "-" as the path writes to stdout, which is flushed after every frame so
+ *   a reader on the other end of a pipe sees frames as they are done.
+ * - area is the number of candidate pixels in the blob, the detection's support.
+ */
+#ifndef DETECTION_LOG_INCLUDED
+#define DETECTION_LOG_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "blobs.h"
+
+using namespace std;
+using namespace cv;
+
+enum DetectionFormat {
+	DETECTIONS_CSV,
+	DETECTIONS_BINARY
+};
+
+const unsigned DETECTION_FRAME_MAGIC = 0x54454442; //"BDET"
+
+#pragma pack(push, 1)
+struct DetectionFrameHeader {
+	unsigned magic;
+	unsigned frame;
+	int64 timestampUs;
+	unsigned count;
+};
+
+struct DetectionRecord {
+	float x, y;
+	float radius;
+	float roundness;
+	int area;
+};
+#pragma pack(pop)
+
+struct Detection {
+	Point2f center;
+	float radius;
+	float roundness;
+	int area;
+};
+
+//the blobs that pass the balloon test, as detections
+void blobsToDetections(const vector<Blob> &blobs, double minRoundness, vector<Detection> &detections);
+
+class DetectionLog {
+public:
+	DetectionLog();
+	~DetectionLog();
+
+	bool open(const string &path, int format = DETECTIONS_CSV);
+	bool isOpen() const { return file != NULL; }
+	void close();
+
+	void write(int frame, int64 timestampUs, const vector<Detection> &detections);
+
+private:
+	FILE *file;
+	bool toStdout;
+	int format;
+};
+#endif
@@ -0,0 +1,192 @@
+/*
+ * Frame and result cache
+ * Description:
+ * Cache entry naming, validation, mapping and writing. See frameCache.h.
+ */
+#include "frameCache.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash) {
+	const unsigned char *p = (const unsigned char *)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+uint64_t hashDetectorParams(const BalloonynessParams &params, double minRoundness) {
+	int fields[] = { params.hueCenter, params.hueDivisor, params.satDivisor, params.threshold };
+	uint64_t hash = hashBytes(fields, sizeof(fields));
+	hash = hashBytes(&minRoundness, sizeof(minRoundness), hash);
+	return hashBytes(&DETECTOR_CACHE_VERSION, sizeof(DETECTOR_CACHE_VERSION), hash);
+}
+
+/*
+ * the key of path as it is now, false if the image can't be looked at
+ */
+static bool currentKey(const string &path, unsigned magic, CacheKeyHeader &key) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+	memset(&key, 0, sizeof(key));
+	key.magic = magic;
+	key.version = DETECTOR_CACHE_VERSION;
+	key.sourceSize = info.st_size;
+	key.sourceMtime = int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+	key.pathHash = hashBytes(path.data(), path.size());
+	return true;
+}
+
+static string entryName(const string &dir, const CacheKeyHeader &key, const char *suffix) {
+	char name[64];
+	sprintf(name, "/%016llx%s", (unsigned long long)key.pathHash, suffix);
+	return dir + name;
+}
+
+/*
+ * writes the blocks to a temporary file and renames it over name
+ */
+static bool writeEntry(const string &name, const void *header, size_t headerSize,
+		const vector< pair<const void *, size_t> > &blocks) {
+	char tmp[64];
+	sprintf(tmp, ".%d.%lx.tmp", (int)getpid(), (unsigned long)pthread_self());
+	string tmpName = name + tmp;
+	FILE *file = fopen(tmpName.c_str(), "wb");
+	if (!file) {
+		perror(tmpName.c_str());
+		return false;
+	}
+	bool ok = fwrite(header, headerSize, 1, file) == 1;
+	for (size_t i = 0; ok && i < blocks.size(); i++) {
+		if (blocks[i].second)
+			ok = fwrite(blocks[i].first, blocks[i].second, 1, file) == 1;
+	}
+	ok = fclose(file) == 0 && ok;
+	if (!ok || rename(tmpName.c_str(), name.c_str()) != 0) {
+		unlink(tmpName.c_str());
+		return false;
+	}
+	return true;
+}
+
+/*
+ * a mapped cache file, unmapped when the last view of it goes
+ */
+struct CacheMapping {
+	void *start;
+	size_t length;
+
+	CacheMapping(void *start, size_t length) : start(start), length(length) {}
+	~CacheMapping() { munmap(start, length); }
+};
+
+bool FrameCache::load(const string &path, FrameView &frame) const {
+	CacheKeyHeader key;
+	if (!enabled() || !currentKey(path, FRAME_CACHE_MAGIC, key))
+		return false;
+
+	int fd = open(entryName(dir, key, ".frame").c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	void *start = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(FrameCacheHeader))
+		start = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); //the mapping keeps the file
+	if (start == MAP_FAILED)
+		return false;
+
+	std::shared_ptr<CacheMapping> mapping(new CacheMapping(start, info.st_size));
+	const FrameCacheHeader *header = (const FrameCacheHeader *)start;
+	if (memcmp(&header->key, &key, sizeof(key)) != 0 || header->width <= 0 || header->height <= 0 ||
+			sizeof(FrameCacheHeader) + size_t(header->step) * header->height > size_t(info.st_size))
+		return false;
+
+	//the detector only reads the pixels, the mapping is read only
+	Mat image(header->height, header->width, header->type, (uchar *)start + sizeof(FrameCacheHeader), header->step);
+	frame = FrameView(image, mapping);
+	return true;
+}
+
+bool FrameCache::store(const string &path, const Mat &bgr) const {
+	FrameCacheHeader header;
+	if (!enabled() || bgr.empty() || !currentKey(path, FRAME_CACHE_MAGIC, header.key))
+		return false;
+	header.width = bgr.cols;
+	header.height = bgr.rows;
+	header.type = bgr.type();
+	header.step = unsigned(bgr.cols * bgr.elemSize());
+
+	vector< pair<const void *, size_t> > rows;
+	for (int y = 0; y < bgr.rows; y++)
+		rows.push_back(make_pair((const void *)bgr.ptr(y), size_t(header.step)));
+	return writeEntry(entryName(dir, header.key, ".frame"), &header, sizeof(header), rows);
+}
+
+bool ResultCache::load(const string &path, Size &size, int &candidates, vector<Detection> &detections) const {
+	CacheKeyHeader key;
+	if (!enabled() || !currentKey(path, RESULT_CACHE_MAGIC, key))
+		return false;
+
+	char suffix[32];
+	sprintf(suffix, "-%016llx.result", (unsigned long long)paramsHash);
+	FILE *file = fopen(entryName(dir, key, suffix).c_str(), "rb");
+	if (!file)
+		return false;
+	ResultCacheHeader header;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(&header.key, &key, sizeof(key)) == 0 &&
+			header.paramsHash == paramsHash;
+	vector<DetectionRecord> records;
+	if (ok) {
+		records.resize(header.count);
+		ok = header.count == 0 || fread(&records[0], sizeof(DetectionRecord), header.count, file) == header.count;
+	}
+	fclose(file);
+	if (!ok)
+		return false;
+
+	size = Size(header.width, header.height);
+	candidates = header.candidates;
+	detections.resize(records.size());
+	for (size_t i = 0; i < records.size(); i++) {
+		detections[i].center = Point2f(records[i].x, records[i].y);
+		detections[i].radius = records[i].radius;
+		detections[i].roundness = records[i].roundness;
+		detections[i].area = records[i].area;
+	}
+	return true;
+}
+
+bool ResultCache::store(const string &path, Size size, int candidates, const vector<Detection> &detections) const {
+	ResultCacheHeader header;
+	if (!enabled() || !currentKey(path, RESULT_CACHE_MAGIC, header.key))
+		return false;
+	header.paramsHash = paramsHash;
+	header.width = size.width;
+	header.height = size.height;
+	header.candidates = candidates;
+	header.count = (unsigned)detections.size();
+
+	vector<DetectionRecord> records(detections.size());
+	for (size_t i = 0; i < detections.size(); i++) {
+		records[i].x = detections[i].center.x;
+		records[i].y = detections[i].center.y;
+		records[i].radius = detections[i].radius;
+		records[i].roundness = detections[i].roundness;
+		records[i].area = detections[i].area;
+	}
+	vector< pair<const void *, size_t> > blocks;
+	if (!records.empty())
+		blocks.push_back(make_pair((const void *)&records[0], records.size() * sizeof(DetectionRecord)));
+
+	char suffix[32];
+	sprintf(suffix, "-%016llx.result", (unsigned long long)paramsHash);
+	return writeEntry(entryName(dir, header.key, suffix), &header, sizeof(header), blocks);
+}
@@ -0,0 +1,100 @@
+/*
+ * Frame and result cache header file
+ * Description:
+ * Keeps what a batch run over stills learned so the next run over the same
+ * images doesn't have to do it again. Decoding a JPEG costs more than
+ * detecting on it.
+ *
+ * FrameCache - every decoded image as one raw file in the cache directory:
+ *   a FrameCacheHeader and the pixels as the BGR rows the detector reads.
+ *   A hit maps the file and hands it out as a FrameView over the mapping,
+ *   no decode and no copy. Entries are keyed by the image's path, and only
+ *   used while its size and mtime are what they were when it was cached.
+ * ResultCache - the detections of an image under one set of parameters,
+ *   keyed the same way plus a hash of the parameters. An image that has not
+ *   changed, run with parameters that have not changed, is skipped entirely.
+ *
+ * Usage:
+ *    FrameCache frames("cache");
+ *    FrameView frame;
+ *    if (!frames.load(path, frame)) { Mat bgr = imread(path); frames.store(path, bgr); ... }
+ *
+ * Note:
+ * - Entries are written to a temporary name and renamed, so workers on
+ *   several threads (or several runs at once) never see half a file.
+ * - Bump DETECTOR_CACHE_VERSION when the detector changes what it finds for
+ *   the same parameters, that drops every cached result.
+ * - Nothing is ever evicted, delete the directory to clear it.
+ */
+#ifndef FRAME_CACHE_INCLUDED
+#define FRAME_CACHE_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "frameSource.h"
+#include "detectionLog.h"
+#include "balloonyness.h"
+
+using namespace std;
+using namespace cv;
+
+const unsigned FRAME_CACHE_MAGIC = 0x4d524642;   //"BFRM"
+const unsigned RESULT_CACHE_MAGIC = 0x53455242;  //"BRES"
+const unsigned DETECTOR_CACHE_VERSION = 1;
+
+#pragma pack(push, 1)
+struct CacheKeyHeader {
+	unsigned magic;
+	unsigned version;
+	uint64_t sourceSize;   //bytes of the image file
+	int64_t sourceMtime;   //nanoseconds
+	uint64_t pathHash;
+};
+
+struct FrameCacheHeader {
+	CacheKeyHeader key;
+	int width, height, type;
+	unsigned step;         //bytes per row, rows follow the header back to back
+};
+
+struct ResultCacheHeader {
+	CacheKeyHeader key;
+	uint64_t paramsHash;
+	int width, height;
+	int candidates;
+	unsigned count;        //DetectionRecords that follow
+};
+#pragma pack(pop)
+
+//64 bit FNV-1a
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ULL);
+//everything that changes what the detector reports
+uint64_t hashDetectorParams(const BalloonynessParams &params, double minRoundness);
+
+class FrameCache {
+public:
+	FrameCache(const string &dir = "") : dir(dir) {}
+
+	bool enabled() const { return !dir.empty(); }
+	//a view over the mapped cache entry, false when there is none or it is stale
+	bool load(const string &path, FrameView &frame) const;
+	bool store(const string &path, const Mat &bgr) const;
+
+private:
+	string dir;
+};
+
+class ResultCache {
+public:
+	ResultCache(const string &dir = "", uint64_t paramsHash = 0) : dir(dir), paramsHash(paramsHash) {}
+
+	bool enabled() const { return !dir.empty(); }
+	bool load(const string &path, Size &size, int &candidates, vector<Detection> &detections) const;
+	bool store(const string &path, Size size, int candidates, const vector<Detection> &detections) const;
+
+private:
+	string dir;
+	uint64_t paramsHash;
+};
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Frame input
+ * Description:
+ * Switch parsing and source selection for frameInput.h.
+ */
+#include "frameInput.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void printFrameInputUsage(const char *program) {
+	fprintf(stderr, "usage: %s [options]\n"
+			"  --input camera[:N] | PATH.rec | PATH  camera, recording or video file\n"
+			"  --fast                               replay recordings as fast as they can be read\n"
+			"  --record PATH                        save every frame read to a recording\n"
+			"  --v4l2 | --no-v4l2                   mapped V4L2 capture or OpenCV capture\n",
+			program);
+}
+
+bool parseFrameInputOptions(int argc, char **argv, FrameInputOptions &options, vector<string> &rest) {
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		if (!strcmp(arg, "--input") && i + 1 < argc) {
+			options.input = argv[++i];
+		} else if (!strcmp(arg, "--fast")) {
+			options.fast = true;
+		} else if (!strcmp(arg, "--record") && i + 1 < argc) {
+			options.recordPath = argv[++i];
+		} else if (!strcmp(arg, "--v4l2")) {
+			options.v4l2 = true;
+		} else if (!strcmp(arg, "--no-v4l2")) {
+			options.v4l2 = false;
+		} else if (!strncmp(arg, "--", 2)) {
+			fprintf(stderr, "unknown option %s\n", arg);
+			printFrameInputUsage(argv[0]);
+			return false;
+		} else {
+			rest.push_back(arg);
+		}
+	}
+	return true;
+}
+
+static bool endsWith(const string &s, const char *suffix) {
+	size_t n = strlen(suffix);
+	return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+bool FrameInput::open(const FrameInputOptions &options, Size size) {
+	active = NULL;
+	live = realtime = false;
+	const string &input = options.input;
+	if (input.empty() || input == "camera" || input.compare(0, 7, "camera:") == 0) {
+		int device = input.size() > 7 ? atoi(input.c_str() + 7) : 0;
+		char path[32];
+		sprintf(path, "/dev/video%d", device);
+		//mapped driver buffers when the camera can give bgr24 or yuyv, OpenCV otherwise
+		if (options.v4l2 && v4l2Camera.open(path, size)) {
+			active = &v4l2Camera;
+		} else if (cvCamera.open(device, size)) {
+			active = &cvCamera;
+		} else {
+			fprintf(stderr, "camera %d not opened\n", device);
+			return false;
+		}
+		live = realtime = true;
+	} else if (endsWith(input, ".rec")) {
+		if (!replay.open(input, options.fast ? REPLAY_FAST : REPLAY_RECORDED))
+			return false;
+		active = &replay;
+		realtime = !options.fast;
+	} else {
+		if (!cvCamera.open(input)) {
+			fprintf(stderr, "could not open %s\n", input.c_str());
+			return false;
+		}
+		active = &cvCamera;
+	}
+
+	if (!options.recordPath.empty() && !recorder.open(options.recordPath)) {
+		active = NULL;
+		return false;
+	}
+	return true;
+}
+
+bool FrameInput::read(FrameView &frame, int64 &stamp) {
+	if (!active || !active->read(frame, stamp))
+		return false;
+	if (recorder.isOpen() && !recorder.write(frame.image(), stamp)) {
+		fprintf(stderr, "recording stopped after %d frames\n", recorder.frames());
+		recorder.close();
+	}
+	return true;
+}
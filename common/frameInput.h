@@ -0,0 +1,87 @@
+/*
+ * Frame input header file
+ * Description:
+ * Picks the frame source a program reads from at run time instead of every
+ * program opening camera 0 itself:
+ *
+ *    --input camera      the camera (the default), camera:N for /dev/videoN
+ *    --input PATH.rec    a recording made with --record, see frameRecorder.h
+ *    --input PATH        anything else is a video file opened through OpenCV
+ *    --fast              replay recordings as fast as they can be read
+ *                        instead of at the pace they were recorded at
+ *    --record PATH       save every frame read to a recording as well
+ *    --v4l2 / --no-v4l2  camera through mapped V4L2 buffers or OpenCV
+ *
+ * A camera is tried through V4L2 first and falls back to OpenCV, like the
+ * camera program always did.
+ *
+ * Usage:
+ *    FrameInputOptions options;
+ *    vector<string> rest;
+ *    if (!parseFrameInputOptions(argc, argv, options, rest)) return 1;
+ *    FrameInput input;
+ *    if (!input.open(options, Size(640, 480))) return 1;
+ *    FrameView frame; int64 stamp;
+ *    while (input.read(frame, stamp)) ...
+ *
+ * Note:
+ * - Programs that take RunOptions get the same switches from there, see
+ *   runOptions.h.
+ * - Video files are read as fast as they decode and stamped when read.
+ * - Needs C++11 (-std=c++11), like frameSource.h.
+ */
+#ifndef FRAME_INPUT_INCLUDED
+#define FRAME_INPUT_INCLUDED
+#include <string>
+#include <vector>
+#include "frameSource.h"
+#include "frameRecorder.h"
+#include "v4l2Capture.h"
+
+using namespace std;
+using namespace cv;
+
+struct FrameInputOptions {
+	string input;        //empty for the camera
+	bool fast;           //recordings as fast as they can be read
+	string recordPath;   //empty for not recording
+	bool v4l2;
+
+	FrameInputOptions() : fast(false), v4l2(true) {}
+};
+
+//returns false and prints the usage on an unknown switch, anything that is not a switch is left in rest
+bool parseFrameInputOptions(int argc, char **argv, FrameInputOptions &options, vector<string> &rest);
+void printFrameInputUsage(const char *program);
+
+class FrameInput : public FrameSource {
+public:
+	FrameInput() : active(NULL), live(false), realtime(false) {}
+
+	//size is what the camera is asked for, files and recordings keep their own. False with a message on stderr
+	bool open(const FrameInputOptions &options, Size size);
+	bool isOpened() const { return active != NULL; }
+
+	//also records the frame when asked to
+	bool read(FrameView &frame, int64 &stamp);
+	Size size() const { return active ? active->size() : Size(); }
+	const char *name() const { return active ? active->name() : "none"; }
+
+	//a camera, a failed read may just be a dropped frame rather than the end
+	bool isLive() const { return live; }
+	//frames come at their own pace whether they are read or not: a camera, or a
+	//recording at the recorded pace. Otherwise a reader that skips frames only loses them
+	bool isRealtime() const { return realtime; }
+	//frames a recording replayed at the recorded pace passed over
+	int skipped() const { return replay.skipped(); }
+	int recorded() const { return recorder.frames(); }
+
+private:
+	V4l2FrameSource v4l2Camera;
+	CvFrameSource cvCamera;
+	ReplayFrameSource replay;
+	FrameRecorder recorder;
+	FrameSource *active;
+	bool live, realtime;
+};
+#endif
@@ -0,0 +1,162 @@
+/*
+ * Frame recording and replay
+ * Description:
+ * Writing, indexing, pacing and mapping of raw recordings. See
+ * frameRecorder.h.
+ */
+#include "frameRecorder.h"
+#include "latency.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+bool FrameRecorder::open(const string &path) {
+	close();
+	file = fopen(path.c_str(), "wb");
+	if (!file) {
+		perror(path.c_str());
+		return false;
+	}
+	this->path = path;
+	memset(&header, 0, sizeof(header));
+	nFrames = 0;
+	return true;
+}
+
+/*
+ * the header is only written with the first frame, that is when the size is known
+ */
+bool FrameRecorder::write(const Mat &frame, int64 stamp) {
+	if (!file || frame.empty())
+		return false;
+	if (nFrames == 0) {
+		header.magic = RECORDING_MAGIC;
+		header.version = RECORDING_VERSION;
+		header.width = frame.cols;
+		header.height = frame.rows;
+		header.type = frame.type();
+		header.step = unsigned(frame.cols * frame.elemSize());
+		uint64_t bytes = sizeof(RecordedFrameHeader) + uint64_t(header.step) * header.height;
+		header.frameBytes = (bytes + RECORDING_ALIGN - 1) / RECORDING_ALIGN * RECORDING_ALIGN;
+		padding.assign(size_t(header.frameBytes - sizeof(header)), 0);
+		if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(&padding[0], padding.size(), 1, file) != 1) {
+			perror(path.c_str());
+			return false;
+		}
+		padding.resize(size_t(header.frameBytes - bytes));
+	} else if (frame.cols != header.width || frame.rows != header.height || frame.type() != header.type) {
+		return false;
+	}
+
+	RecordedFrameHeader record;
+	record.stamp = stamp;
+	bool ok = fwrite(&record, sizeof(record), 1, file) == 1;
+	for (int y = 0; ok && y < frame.rows; y++)
+		ok = fwrite(frame.ptr(y), header.step, 1, file) == 1;
+	if (ok && !padding.empty())
+		ok = fwrite(&padding[0], padding.size(), 1, file) == 1;
+	if (!ok) {
+		perror(path.c_str());
+		return false;
+	}
+	++nFrames;
+	return true;
+}
+
+void FrameRecorder::close() {
+	if (file) {
+		fclose(file);
+		file = NULL;
+	}
+}
+
+bool ReplayFrameSource::open(const string &path, int pace) {
+	close();
+	fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		perror(path.c_str());
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+			header.magic != RECORDING_MAGIC || header.version != RECORDING_VERSION ||
+			header.width <= 0 || header.height <= 0 ||
+			header.frameBytes < sizeof(RecordedFrameHeader) + uint64_t(header.step) * header.height) {
+		fprintf(stderr, "%s is not a recording\n", path.c_str());
+		close();
+		return false;
+	}
+
+	//a recording cut short (the recorder was killed) just ends at its last whole frame
+	int n = int(info.st_size / header.frameBytes) - 1;
+	stamps.resize(max(n, 0));
+	for (int i = 0; i < n; i++) {
+		RecordedFrameHeader record;
+		if (pread(fd, &record, sizeof(record), off_t((i + 1) * header.frameBytes)) != (ssize_t)sizeof(record)) {
+			stamps.resize(i);
+			break;
+		}
+		stamps[i] = record.stamp;
+	}
+	this->pace = pace;
+	next = 0;
+	nSkipped = 0;
+	start = 0;
+	return true;
+}
+
+void ReplayFrameSource::close() {
+	if (fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+	stamps.clear();
+}
+
+/*
+ * one mapped frame record, unmapped when the last view of it goes
+ */
+struct RecordingMapping {
+	void *start;
+	size_t length;
+
+	RecordingMapping(void *start, size_t length) : start(start), length(length) {}
+	~RecordingMapping() { munmap(start, length); }
+};
+
+bool ReplayFrameSource::read(FrameView &frame, int64 &stamp) {
+	if (fd < 0 || next >= (int)stamps.size())
+		return false;
+	int64 now = monotonicMicros();
+	if (next == 0)
+		start = now;
+	int64 first = stamps[0];
+
+	int index = next;
+	if (pace == REPLAY_RECORDED) {
+		//the newest frame that is due, or wait for the next one
+		while (index + 1 < (int)stamps.size() && start + stamps[index + 1] - first <= now)
+			index++;
+		int64 due = start + stamps[index] - first;
+		if (due > now)
+			usleep(useconds_t(due - now));
+		nSkipped += index - next;
+	}
+	next = index + 1;
+	stamp = start + stamps[index] - first;
+
+	//mappings have to start on a page, the record may not if the page size is bigger than RECORDING_ALIGN
+	static const uint64_t page = uint64_t(sysconf(_SC_PAGESIZE));
+	uint64_t offset = uint64_t(index + 1) * header.frameBytes + sizeof(RecordedFrameHeader);
+	uint64_t mapStart = offset / page * page;
+	size_t length = size_t(offset - mapStart + uint64_t(header.step) * header.height);
+	void *mapped = mmap(NULL, length, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, off_t(mapStart));
+	if (mapped == MAP_FAILED)
+		return false;
+	std::shared_ptr<RecordingMapping> mapping(new RecordingMapping(mapped, length));
+	Mat image(header.height, header.width, header.type, (uchar *)mapped + (offset - mapStart), header.step);
+	frame = FrameView(image, mapping);
+	return true;
+}
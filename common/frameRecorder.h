@@ -0,0 +1,126 @@
+/*
+ * Frame recording and replay header file
+ * Description:
+ * Saves camera frames losslessly with their capture times and plays them
+ * back as a FrameSource, so a run on the bench can be repeated frame for
+ * frame without a camera attached, and runs on different machines see the
+ * same input.
+ *
+ * A recording is one raw file: a RecordingHeader, then every frame as a
+ * RecordedFrameHeader (the capture stamp) and the BGR rows back to back.
+ * Every frame record starts on a RECORDING_ALIGN boundary, so replay maps
+ * each frame on its own and hands it out as a FrameView over the mapping.
+ * There is no decode and no copy, like the mapped V4L2 capture, and a long
+ * recording never needs more address space than the frames in flight.
+ *
+ * FrameRecorder - appends frames to a recording.
+ * ReplayFrameSource - reads one back, either
+ *    REPLAY_RECORDED  at the recorded pace: read() waits until the next
+ *                     frame is due and skips the frames whose time has
+ *                     already passed, like a camera overwriting a frame
+ *                     nobody took. Tests what a slow stage drops.
+ *    REPLAY_FAST      every frame, as fast as they are asked for. Measures
+ *                     throughput.
+ *
+ * Usage:
+ *    FrameRecorder recorder;
+ *    recorder.open("flight.rec");
+ *    while (camera.read(frame, stamp)) recorder.write(frame.image(), stamp);
+ *
+ *    ReplayFrameSource replay;
+ *    replay.open("flight.rec", REPLAY_FAST);
+ *    while (replay.read(frame, stamp)) ...
+ *
+ * Note:
+ * - Stamps handed out keep the recorded spacing, moved to start when the
+ *   replay does. In fast mode they run ahead of monotonicMicros(), but
+ *   anything that works from the time between frames sees what it saw live.
+ * - Frames are written synchronously on the thread that captured them. A
+ *   720p frame is 2.7MB, record to a disk that keeps up (or tmpfs) or the
+ *   gaps end up in the recording.
+ * - Every frame of a recording has the size and type of the first one.
+ * - Linux only (mmap).
+ */
+#ifndef FRAME_RECORDER_INCLUDED
+#define FRAME_RECORDER_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+#include "frameSource.h"
+
+using namespace std;
+using namespace cv;
+
+const unsigned RECORDING_MAGIC = 0x43455242;  //"BREC"
+const unsigned RECORDING_VERSION = 1;
+const int RECORDING_ALIGN = 4096;             //a page, frame records can be mapped one at a time
+
+#pragma pack(push, 1)
+struct RecordingHeader {
+	unsigned magic;
+	unsigned version;
+	int width, height, type;
+	unsigned step;         //bytes per row
+	uint64_t frameBytes;   //one frame record with its padding, the first starts at frameBytes too
+};
+
+struct RecordedFrameHeader {
+	int64_t stamp;         //capture time in microseconds, the pixel rows follow
+};
+#pragma pack(pop)
+
+enum ReplayPace {
+	REPLAY_RECORDED,
+	REPLAY_FAST
+};
+
+class FrameRecorder {
+public:
+	FrameRecorder() : file(NULL), nFrames(0) {}
+	~FrameRecorder() { close(); }
+
+	bool open(const string &path);
+	bool isOpen() const { return file != NULL; }
+	//false if the frame couldn't be written or doesn't match the first one
+	bool write(const Mat &frame, int64 stamp);
+	void close();
+
+	int frames() const { return nFrames; }
+
+private:
+	FILE *file;
+	string path;
+	RecordingHeader header;
+	vector<uchar> padding;
+	int nFrames;
+};
+
+class ReplayFrameSource : public FrameSource {
+public:
+	ReplayFrameSource() : fd(-1), pace(REPLAY_FAST), next(0), nSkipped(0), start(0) {}
+	~ReplayFrameSource() { close(); }
+
+	bool open(const string &path, int pace);
+	bool isOpened() const { return fd >= 0; }
+	void close();
+
+	bool read(FrameView &frame, int64 &stamp);
+	Size size() const { return fd >= 0 ? Size(header.width, header.height) : Size(); }
+	const char *name() const { return "replay"; }
+
+	int frames() const { return (int)stamps.size(); }
+	//frames passed over because their time had gone by, only in REPLAY_RECORDED
+	int skipped() const { return nSkipped; }
+
+private:
+	int fd;
+	int pace;
+	RecordingHeader header;
+	vector<int64> stamps;
+	int next;
+	int nSkipped;
+	int64 start;           //monotonicMicros() of the first read
+};
+#endif
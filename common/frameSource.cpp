@@ -0,0 +1,66 @@
+/*
+ * Frame sources
+ * Description:
+ * The frame pool and the OpenCV VideoCapture source. See frameSource.h.
+ */
+#include "frameSource.h"
+#include "latency.h"
+
+Mat FramePool::next(Size size, int type) {
+	if (size.area() == 0)
+		return Mat();
+	for (size_t i = 0; i < mats.size(); i++) {
+		Mat &m = mats[i];
+		//only the pool holds it, nobody else can take a new reference to it
+		if (m.refcount && *m.refcount == 1 && m.size() == size && m.type() == type)
+			return m;
+	}
+	Mat m(size, type);
+	if ((int)mats.size() < capacity)
+		mats.push_back(m);
+	return m;
+}
+
+bool CvFrameSource::open(int device, Size size) {
+	fromFile = false;
+	if (!camera.open(device))
+		return false;
+	camera.set(CV_CAP_PROP_FRAME_WIDTH, size.width);
+	camera.set(CV_CAP_PROP_FRAME_HEIGHT, size.height);
+	return true;
+}
+
+bool CvFrameSource::open(const string &path) {
+	fromFile = true;
+	fileStart = monotonicMicros();
+	lastMillis = -1;
+	return camera.open(path);
+}
+
+Size CvFrameSource::size() const {
+	VideoCapture &c = const_cast<VideoCapture &>(camera);
+	return Size(int(c.get(CV_CAP_PROP_FRAME_WIDTH)), int(c.get(CV_CAP_PROP_FRAME_HEIGHT)));
+}
+
+bool CvFrameSource::read(FrameView &frame, int64 &stamp) {
+	if (!camera.grab())
+		return false;
+	stamp = monotonicMicros();
+	if (fromFile) {
+		double millis = camera.get(CV_CAP_PROP_POS_MSEC);
+		if (millis <= lastMillis) {
+			//backends that don't know the position, count frames at the file's rate
+			double fps = camera.get(CV_CAP_PROP_FPS);
+			millis = lastMillis + 1000.0 / (fps > 0 ? fps : 30);
+		}
+		lastMillis = millis;
+		stamp = fileStart + int64(millis * 1000);
+	}
+	//retrieve() copies out of VideoCapture's own buffer, straight into a pooled Mat
+	Mat image = pool.next(lastSize, CV_8UC3);
+	if (!camera.retrieve(image) || image.empty())
+		return false;
+	lastSize = image.size();
+	frame = FrameView(image);
+	return true;
+}
@@ -0,0 +1,96 @@
+/*
+ * Frame sources header file
+ * Description:
+ * What the capture stage reads frames from. A frame is handed on as a
+ * FrameView: a read only Mat header plus a reference on whatever owns the
+ * pixels. Copying a view is cheap (no pixels move) and the owner only gets
+ * its memory back when the last copy has been released, so the capture
+ * buffer can go from the driver through the detector and the display
+ * without ever being copied.
+ *
+ * FrameSource - the interface, read() blocks for the next frame.
+ * CvFrameSource - OpenCV VideoCapture, for cameras the V4L2 source can't
+ *   map (MJPEG only cameras, other platforms) and for video files.
+ * FramePool - a few recycled Mats for sources that have to fill a buffer of
+ *   their own. A Mat is only reused once no view references it any more.
+ *
+ * Note:
+ * - The pixels of a view are shared, never draw on view.image(). clone() it
+ *   if it has to be written to.
+ * - Release views (or let them go out of scope) as soon as a stage is done,
+ *   a source with a fixed number of buffers stalls while they are all held.
+ * - Needs C++11 (-std=c++11) for std::shared_ptr.
+ */
+#ifndef FRAME_SOURCE_INCLUDED
+#define FRAME_SOURCE_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <memory>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+class FrameView {
+public:
+	FrameView() {}
+	FrameView(const Mat &image, const std::shared_ptr<void> &owner = std::shared_ptr<void>())
+		: frame(image), owner(owner) {}
+
+	const Mat &image() const { return frame; }
+	bool empty() const { return frame.empty(); }
+	Size size() const { return frame.size(); }
+	//private copy of the pixels that can be drawn on
+	Mat clone() const { return frame.clone(); }
+	//drops this reference, the owner gets the buffer back when it was the last one
+	void release() { frame.release(); owner.reset(); }
+
+private:
+	Mat frame;
+	std::shared_ptr<void> owner; //keeps the buffer under frame alive and out of the source's hands
+};
+
+class FrameSource {
+public:
+	virtual ~FrameSource() {}
+
+	//blocks until the next frame, stamp in monotonicMicros() time. false when there are no more
+	virtual bool read(FrameView &frame, int64 &stamp) = 0;
+	virtual Size size() const = 0;
+	virtual const char *name() const = 0;
+};
+
+class FramePool {
+public:
+	FramePool(int capacity = 4) : capacity(capacity) {}
+
+	//a Mat of the given size and type that no view is using, allocated when there is none
+	Mat next(Size size, int type);
+
+private:
+	int capacity;
+	vector<Mat> mats;
+};
+
+class CvFrameSource : public FrameSource {
+public:
+	CvFrameSource() : fromFile(false), fileStart(0), lastMillis(-1) {}
+	bool open(int device, Size size);
+	//a video file, read as fast as it decodes. Stamps are the open time plus each frame's position in
+	//the video, so the time between stamps is the time between the frames as they were filmed
+	bool open(const string &path);
+	bool isOpened() const { return camera.isOpened(); }
+
+	bool read(FrameView &frame, int64 &stamp);
+	Size size() const;
+	const char *name() const { return "opencv"; }
+
+private:
+	VideoCapture camera;
+	FramePool pool;
+	Size lastSize;
+	bool fromFile;
+	int64 fileStart;   //monotonicMicros() when the file was opened
+	double lastMillis; //position of the last frame read from the file
+};
+#endif
@@ -0,0 +1,116 @@
+/*
+ * Ground truth
+ * Description:
+ * Manifest reading and detection matching. See groundTruth.h.
+ */
+#include "groundTruth.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <map>
+
+void MatchStats::add(const MatchStats &other) {
+	labels += other.labels;
+	found += other.found;
+	falsePositives += other.falsePositives;
+	errorSum += other.errorSum;
+	radiusErrorSum += other.radiusErrorSum;
+}
+
+bool loadManifest(const string &path, vector<LabelledImage> &images) {
+	FILE *file = fopen(path.c_str(), "r");
+	if (!file) {
+		perror(path.c_str());
+		return false;
+	}
+	size_t slash = path.rfind('/');
+	string dir = slash == string::npos ? "" : path.substr(0, slash + 1);
+
+	map<string, size_t> index;
+	char line[1024], name[1024];
+	int lineNo = 0;
+	bool ok = true;
+	while (fgets(line, sizeof(line), file)) {
+		++lineNo;
+		char *p = line + strspn(line, " \t");
+		if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0)
+			continue;
+		float x, y, radius;
+		if (sscanf(p, "%1023s %f %f %f", name, &x, &y, &radius) != 4 || radius < 0) {
+			fprintf(stderr, "%s:%d: expected: image x y radius\n", path.c_str(), lineNo);
+			ok = false;
+			continue;
+		}
+		string imagePath = name[0] == '/' ? string(name) : dir + name;
+		if (!index.count(imagePath)) {
+			index[imagePath] = images.size();
+			images.push_back(LabelledImage());
+			images.back().path = imagePath;
+		}
+		if (radius > 0) {
+			BalloonLabel label;
+			label.center = Point2f(x, y);
+			label.radius = radius;
+			images[index[imagePath]].balloons.push_back(label);
+		}
+	}
+	fclose(file);
+	return ok;
+}
+
+Rect centreCrop(Size from, Size to) {
+	int width = from.width, height = from.height;
+	if (int64(width) * to.height > int64(height) * to.width)
+		width = int(int64(height) * to.width / to.height);
+	else
+		height = int(int64(width) * to.height / to.width);
+	return Rect((from.width - width) / 2, (from.height - height) / 2, width, height);
+}
+
+vector<BalloonLabel> scaleLabels(const vector<BalloonLabel> &labels, Rect crop, Size to) {
+	vector<BalloonLabel> scaled;
+	float sx = float(to.width) / crop.width;
+	float sy = float(to.height) / crop.height;
+	for (size_t i = 0; i < labels.size(); i++) {
+		Point2f c = labels[i].center - Point2f(crop.x, crop.y);
+		if (c.x < 0 || c.y < 0 || c.x >= crop.width || c.y >= crop.height)
+			continue;
+		BalloonLabel label;
+		label.center = Point2f(c.x * sx, c.y * sy);
+		label.radius = labels[i].radius * sqrt(sx * sy);
+		scaled.push_back(label);
+	}
+	return scaled;
+}
+
+MatchStats matchDetections(const vector<BalloonLabel> &labels, const vector<Detection> &detections) {
+	MatchStats stats;
+	stats.labels = (int)labels.size();
+	vector<bool> used(detections.size(), false);
+	for (size_t i = 0; i < labels.size(); i++) {
+		double limit = GT_MATCH_RADIUS_FACTOR * labels[i].radius + GT_MATCH_SLACK;
+		int best = -1;
+		double bestDistance = 0;
+		for (size_t j = 0; j < detections.size(); j++) {
+			if (used[j])
+				continue;
+			Point2f d = detections[j].center - labels[i].center;
+			double distance = sqrt(d.x * d.x + d.y * d.y);
+			if (distance <= limit && (best < 0 || distance < bestDistance)) {
+				best = (int)j;
+				bestDistance = distance;
+			}
+		}
+		if (best >= 0) {
+			used[best] = true;
+			++stats.found;
+			stats.errorSum += bestDistance;
+			stats.radiusErrorSum += fabs(detections[best].radius - labels[i].radius);
+		}
+	}
+	for (size_t j = 0; j < detections.size(); j++) {
+		if (!used[j])
+			++stats.falsePositives;
+	}
+	return stats;
+}
@@ -0,0 +1,67 @@
+/*
+ * Ground truth header file
+ * Description:
+ * Labelled balloon positions for still images and the matching of
+ * detections against them, so a detector change can be scored instead of
+ * looked at.
+ *
+ * Manifest format, one balloon per line, image paths relative to the manifest:
+ *    # comment
+ *    Balloon_Park_15.jpg 2084 1171 28
+ * x, y and radius are in pixels of the image as stored. An image listed with
+ * radius 0 and nothing else has no balloon in it.
+ *
+ * A detection matches a label when its centre is within
+ * GT_MATCH_RADIUS_FACTOR * radius + GT_MATCH_SLACK pixels of the label's
+ * centre. Each label takes the closest matching detection, every detection
+ * that is left over is a false positive.
+ *
+ * Note:
+ * - scaleLabels() maps labels onto a resized/cropped copy of the image, labels
+ *   whose centre falls outside the copy are dropped.
+ */
+#ifndef GROUND_TRUTH_INCLUDED
+#define GROUND_TRUTH_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+#include "detectionLog.h"
+
+using namespace std;
+using namespace cv;
+
+const double GT_MATCH_RADIUS_FACTOR = 1.5;
+const double GT_MATCH_SLACK = 3;
+
+struct BalloonLabel {
+	Point2f center;
+	float radius;
+};
+
+struct LabelledImage {
+	string path;
+	vector<BalloonLabel> balloons;
+};
+
+struct MatchStats {
+	int labels;          //balloons that should have been found
+	int found;
+	int falsePositives;
+	double errorSum;     //centre distance of the found ones, pixels
+	double radiusErrorSum;
+
+	MatchStats() : labels(0), found(0), falsePositives(0), errorSum(0), radiusErrorSum(0) {}
+	void add(const MatchStats &other);
+	double detectionRate() const { return labels ? double(found) / labels : 0; }
+	double meanError() const { return found ? errorSum / found : 0; }
+	double meanRadiusError() const { return found ? radiusErrorSum / found : 0; }
+};
+
+//false if the manifest can't be read or has a bad line (reported on stderr)
+bool loadManifest(const string &path, vector<LabelledImage> &images);
+//the largest rect of the aspect of to in the middle of from
+Rect centreCrop(Size from, Size to);
+//labels of an image of size from, after cropping it to crop and resizing the crop to size to
+vector<BalloonLabel> scaleLabels(const vector<BalloonLabel> &labels, Rect crop, Size to);
+MatchStats matchDetections(const vector<BalloonLabel> &labels, const vector<Detection> &detections);
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Hue x saturation histogram
+ * Description:
+ * The key tables, the histogram and the one read per pixel back projection.
+ * See hueSatHistogram.h for the key layout.
+ */
+#include "hueSatHistogram.h"
+
+void HsvKeys::build(const HsvGate &gate) {
+	int vLow = min(gate.vMin, gate.vMax), vHigh = max(gate.vMin, gate.vMax);
+	for (int i = 0; i < 256; i++) {
+		//hues past 179 never come out of cvtColor, reject them rather than run off the table
+		hue[i] = i < 180 ? uint16_t(i << HS_SAT_BITS) : uint16_t(HS_KEY_REJECT);
+		sat[i] = i >= gate.sMin ? uint16_t(i >> (8 - HS_SAT_BITS)) : uint16_t(HS_KEY_REJECT);
+		val[i] = i >= vLow && i <= vHigh ? 0 : uint16_t(HS_KEY_REJECT);
+	}
+}
+
+HueSatHistogram::HueSatHistogram(int hueBins, int satBins) : nHue(hueBins), nSat(satBins) {
+	//a power of two so every bin is whole key saturation levels, the same bins calcHist would make
+	CV_Assert(hueBins >= 1 && hueBins <= 180 && satBins >= 1 && satBins <= (1 << HS_SAT_BITS) &&
+			(satBins & (satBins - 1)) == 0);
+	hueBin.resize(180);
+	for (int h = 0; h < 180; h++)
+		hueBin[h] = uchar(h * nHue / 180);
+	initial = Mat::zeros(nHue, nSat, CV_32F);
+	adaptive = Mat::zeros(nHue, nSat, CV_32F);
+	current = Mat::zeros(nHue, nSat, CV_32F);
+	hist = Mat::zeros(nHue, nSat, CV_32F);
+	table.assign(HS_TABLE_SIZE, 0);
+}
+
+void HueSatHistogram::measure(const Mat &hsv, const HsvKeys &keys, Mat &bins) const {
+	CV_Assert(hsv.type() == CV_8UC3);
+	bins.create(nHue, nSat, CV_32F);
+	bins = Scalar::all(0);
+	const int satShift = HS_SAT_BITS, satMask = (1 << HS_SAT_BITS) - 1;
+	int total = 0;
+	for (int y = 0; y < hsv.rows; y++) {
+		const uchar *p = hsv.ptr<uchar>(y);
+		for (int x = 0; x < hsv.cols; x++, p += 3) {
+			int key = keys.key(p);
+			if (key >= HS_KEY_REJECT)
+				continue;
+			bins.ptr<float>(hueBin[key >> satShift])[((key & satMask) * nSat) >> satShift]++;
+			total++;
+		}
+	}
+	if (total > 0)
+		bins *= 1.0 / total;
+}
+
+double HueSatHistogram::similarity(const Mat &bins) const {
+	double sum = 0;
+	for (int h = 0; h < nHue; h++) {
+		const float *a = current.ptr<float>(h), *b = bins.ptr<float>(h);
+		for (int s = 0; s < nSat; s++)
+			sum += sqrt(double(a[s]) * b[s]);
+	}
+	return sum;
+}
+
+void HueSatHistogram::build(const Mat &hsv, const HsvKeys &keys) {
+	measure(hsv, keys, initial);
+	initial.copyTo(adaptive);
+	fillTable();
+}
+
+void HueSatHistogram::blend(const Mat &bins, float rate) {
+	for (int h = 0; h < nHue; h++) {
+		float *a = adaptive.ptr<float>(h);
+		const float *b = bins.ptr<float>(h);
+		for (int s = 0; s < nSat; s++)
+			a[s] += rate * (b[s] - a[s]);
+	}
+	fillTable();
+}
+
+void HueSatHistogram::fillTable() {
+	float highest = 0;
+	for (int h = 0; h < nHue; h++) {
+		float *m = current.ptr<float>(h);
+		const float *a = adaptive.ptr<float>(h), *i = initial.ptr<float>(h);
+		for (int s = 0; s < nSat; s++) {
+			m[s] = (1 - HS_MODEL_ANCHOR) * a[s] + HS_MODEL_ANCHOR * i[s];
+			highest = max(highest, m[s]);
+		}
+	}
+	current.copyTo(hist);
+	if (highest > 0)
+		hist *= 255.0 / highest;
+	//everything from HS_KEY_REJECT up stays 0
+	for (int h = 0; h < 180; h++) {
+		const float *row = hist.ptr<float>(hueBin[h]);
+		for (int s = 0; s < (1 << HS_SAT_BITS); s++)
+			table[(h << HS_SAT_BITS) | s] = saturate_cast<uchar>(row[(s * nSat) >> HS_SAT_BITS]);
+	}
+}
+
+void HueSatHistogram::backProject(const Mat &hsv, const HsvKeys &keys, Mat &dst) const {
+	CV_Assert(hsv.type() == CV_8UC3);
+	dst.create(hsv.size(), CV_8UC1);
+	const uchar *t = &table[0];
+	for (int y = 0; y < hsv.rows; y++) {
+		const uchar *p = hsv.ptr<uchar>(y);
+		uchar *d = dst.ptr<uchar>(y);
+		for (int x = 0; x < hsv.cols; x++, p += 3)
+			d[x] = t[keys.key(p)];
+	}
+}
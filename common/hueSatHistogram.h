@@ -0,0 +1,110 @@
+/*
+ * Hue x saturation histogram header file
+ * Description:
+ * A two dimensional hue by saturation colour model whose back projection is
+ * one table read per pixel, with the saturation and value gate in the same
+ * read. Back projecting a hue histogram and masking it the usual way is
+ * four passes (inRange, split off the hue, calcBackProject, and the mask),
+ * this is one pass over the HSV pixels.
+ *
+ * Every pixel is turned into a packed key by three 256 entry lookups, one
+ * per channel, OR'd together:
+ *    hue << HS_SAT_BITS | saturation >> (8 - HS_SAT_BITS)
+ * A saturation under the gate's minimum or a value outside its range looks
+ * up HS_KEY_REJECT instead, a bit above every real key, and the table is
+ * zero from there on. So the gate costs no compare or second pass. The keys
+ * only change with the gate and are shared by every histogram; the table
+ * only changes with the histogram and holds each key's bin, 0..255.
+ *
+ * Using saturation as well as hue keeps pale and grey pixels whose hue
+ * happens to match (sky, concrete, sun on paint) from back projecting as
+ * strongly as the saturated colour that was selected.
+ *
+ * The model can follow the light. blend() folds the colours of a window the
+ * tracker is sure of into an adaptive histogram with exponential decay, and
+ * the table is built from that mixed with HS_MODEL_ANCHOR of the selection's
+ * histogram, so however long it adapts it can't forget what was selected.
+ * similarity() compares a window with the model, for the caller to turn
+ * away windows that have drifted onto something else. Light that changes
+ * slowly is followed, a window of a different colour is not.
+ *
+ * Usage:
+ *    HsvKeys keys(HsvGate(s_min, v_min, v_max));
+ *    HueSatHistogram model(32, 8);
+ *    model.build(hsvOfSelection, keys);
+ *    model.backProject(hsvOfSearch, keys, backproj);
+ *    model.measure(hsvOfTrackedWindow, keys, bins);
+ *    if (model.similarity(bins) > 0.6) model.blend(bins, 0.05);
+ *
+ * Note:
+ * - hsv is what cvtColor(..., COLOR_BGR2HSV) gives for 8 bit images, hue
+ *   0..179.
+ * - satBins has to be a power of two up to 64. The bins and the gate are
+ *   then exactly what calcHist over [0,180) x [0,256) and inRange give.
+ * - The table is (HS_KEY_REJECT + 180 << HS_SAT_BITS) bytes, 27KB, so it
+ *   stays in L1 while a window is back projected.
+ */
+#ifndef HUE_SAT_HISTOGRAM_INCLUDED
+#define HUE_SAT_HISTOGRAM_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+using namespace cv;
+
+//saturation levels kept in the key, 6 bits = 64
+const int HS_SAT_BITS = 6;
+//set in the key of a pixel the gate rejects, above every hue/saturation key
+const int HS_KEY_REJECT = 1 << 14;
+const int HS_TABLE_SIZE = HS_KEY_REJECT + (180 << HS_SAT_BITS);
+//share of the selection's histogram that always stays in the model
+const float HS_MODEL_ANCHOR = 0.3f;
+
+//pixels that take part: saturation at least sMin, value between vMin and vMax
+struct HsvGate {
+	int sMin, vMin, vMax;
+	HsvGate(int sMin = 0, int vMin = 0, int vMax = 256) : sMin(sMin), vMin(vMin), vMax(vMax) {}
+};
+
+//the per channel parts of the packed key
+struct HsvKeys {
+	uint16_t hue[256], sat[256], val[256];
+
+	HsvKeys(const HsvGate &gate = HsvGate()) { build(gate); }
+	void build(const HsvGate &gate);
+	inline int key(const uchar *hsv) const { return hue[hsv[0]] | sat[hsv[1]] | val[hsv[2]]; }
+};
+
+class HueSatHistogram {
+public:
+	HueSatHistogram(int hueBins = 32, int satBins = 8);
+
+	//histogram of the pixels of hsv the keys don't reject, the fullest bin scaled to 255. Starts the model over
+	void build(const Mat &hsv, const HsvKeys &keys);
+	//dst: CV_8UC1 the size of hsv, every pixel's bin and 0 where the gate rejects it
+	void backProject(const Mat &hsv, const HsvKeys &keys, Mat &dst) const;
+
+	//bins: hueBins x satBins CV_32F histogram of hsv summing to 1, all 0 when the gate rejects every pixel
+	void measure(const Mat &hsv, const HsvKeys &keys, Mat &bins) const;
+	//Bhattacharyya coefficient of measured bins and the model's: 1 the same colours, 0 none in common
+	double similarity(const Mat &bins) const;
+	//adaptive = (1 - rate) adaptive + rate bins, and the table is rebuilt
+	void blend(const Mat &bins, float rate);
+
+	int hueBins() const { return nHue; }
+	int satBins() const { return nSat; }
+	//hueBins x satBins CV_32F, 0..255, what the table holds
+	const Mat &bins() const { return hist; }
+
+private:
+	void fillTable();
+
+	int nHue, nSat;
+	vector<uchar> hueBin;  //bin of every hue, 0..179
+	Mat initial, adaptive; //summing to 1: the selection's and the blended histogram
+	Mat current;           //summing to 1: the anchored mix of the two the table is built from
+	Mat hist;
+	vector<uchar> table;
+};
+#endif
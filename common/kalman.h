@@ -0,0 +1,257 @@
+/*
+ * Fixed size Kalman filter header file
+ * Description:
+ * A Kalman filter whose sizes are template arguments, so every matrix is a
+ * plain float array on the stack or in the owning object. cv::KalmanFilter
+ * keeps its matrices as Mats and predict()/correct() create temporaries on
+ * the heap every call; this one never allocates after construction.
+ *
+ * FixedKalman<N, M> - the general filter, N states and M measurements, with
+ *   the transition, measurement and noise matrices open to set directly.
+ * MotionKalman<ORDER> - a point moving in the image: position, velocity
+ *   and, for ORDER 2, acceleration in x and y, measured by its position.
+ *   predict() takes the time since the last frame, so the transition
+ *   actually moves the point by its velocity and a dropped frame is
+ *   predicted across the whole gap instead of one frame's worth. The
+ *   process noise is the continuous white noise model: a random
+ *   acceleration (ORDER 1) or jerk (ORDER 2) of spectral density q, so the
+ *   uncertainty grows with dt the way it should.
+ * ConstantVelocityKalman / ConstantAccelerationKalman - ORDER 1 and 2.
+ *
+ * Usage:
+ *    ConstantVelocityKalman kal;
+ *    kal.init(centre, 1e4, 4, 1e4);              //q in px^2/s^3, R in px^2, velocity variance in px^2/s^2
+ *    kal.predict((stamp - lastStamp) / 1e6);     //seconds from the capture time stamps
+ *    Point2f p = kal.position(); float s = kal.positionSigma();  //where to search and how far around it
+ *    kal.correct(measured);
+ *
+ * Note:
+ * - State order is (x, y, Vx, Vy[, Ax, Ay]), velocities in pixels per second.
+ * - Matrices are tiny (at most 6x6), the products are written out as loops
+ *   the compiler unrolls.
+ */
+#ifndef KALMAN_INCLUDED
+#define KALMAN_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <math.h>
+#include <algorithm>
+
+using namespace cv;
+
+template <int R, int C>
+struct FixedMat {
+	float m[R][C];
+
+	float *operator[](int r) { return m[r]; }
+	const float *operator[](int r) const { return m[r]; }
+
+	static FixedMat zeros() {
+		FixedMat a;
+		for (int r = 0; r < R; r++)
+			for (int c = 0; c < C; c++)
+				a.m[r][c] = 0;
+		return a;
+	}
+	static FixedMat identity(float d = 1) {
+		FixedMat a = zeros();
+		for (int i = 0; i < R && i < C; i++)
+			a.m[i][i] = d;
+		return a;
+	}
+	FixedMat<C, R> t() const {
+		FixedMat<C, R> a;
+		for (int r = 0; r < R; r++)
+			for (int c = 0; c < C; c++)
+				a.m[c][r] = m[r][c];
+		return a;
+	}
+};
+
+template <int R, int K, int C>
+inline FixedMat<R, C> operator*(const FixedMat<R, K> &a, const FixedMat<K, C> &b) {
+	FixedMat<R, C> p;
+	for (int r = 0; r < R; r++) {
+		for (int c = 0; c < C; c++) {
+			float s = 0;
+			for (int k = 0; k < K; k++)
+				s += a.m[r][k] * b.m[k][c];
+			p.m[r][c] = s;
+		}
+	}
+	return p;
+}
+
+template <int R, int C>
+inline FixedMat<R, C> operator+(FixedMat<R, C> a, const FixedMat<R, C> &b) {
+	for (int r = 0; r < R; r++)
+		for (int c = 0; c < C; c++)
+			a.m[r][c] += b.m[r][c];
+	return a;
+}
+
+template <int R, int C>
+inline FixedMat<R, C> operator-(FixedMat<R, C> a, const FixedMat<R, C> &b) {
+	for (int r = 0; r < R; r++)
+		for (int c = 0; c < C; c++)
+			a.m[r][c] -= b.m[r][c];
+	return a;
+}
+
+/*
+ * Gauss-Jordan with partial pivoting. false (and inv untouched) when a is
+ * singular
+ */
+template <int N>
+bool invert(const FixedMat<N, N> &a, FixedMat<N, N> &inv) {
+	FixedMat<N, N> w = a, out = FixedMat<N, N>::identity();
+	for (int c = 0; c < N; c++) {
+		int pivot = c;
+		for (int r = c + 1; r < N; r++)
+			if (fabs(w.m[r][c]) > fabs(w.m[pivot][c]))
+				pivot = r;
+		if (w.m[pivot][c] == 0)
+			return false;
+		for (int k = 0; k < N; k++) {
+			std::swap(w.m[c][k], w.m[pivot][k]);
+			std::swap(out.m[c][k], out.m[pivot][k]);
+		}
+		float scale = 1 / w.m[c][c];
+		for (int k = 0; k < N; k++) {
+			w.m[c][k] *= scale;
+			out.m[c][k] *= scale;
+		}
+		for (int r = 0; r < N; r++) {
+			if (r == c || w.m[r][c] == 0)
+				continue;
+			float f = w.m[r][c];
+			for (int k = 0; k < N; k++) {
+				w.m[r][k] -= f * w.m[c][k];
+				out.m[r][k] -= f * out.m[c][k];
+			}
+		}
+	}
+	inv = out;
+	return true;
+}
+
+template <int N, int M>
+class FixedKalman {
+public:
+	FixedMat<N, 1> state;
+	FixedMat<N, N> errorCov;         //P
+	FixedMat<N, N> transition;       //F
+	FixedMat<N, N> processNoise;     //Q
+	FixedMat<M, N> measurement;      //H
+	FixedMat<M, M> measurementNoise; //R
+
+	FixedKalman() {
+		state = FixedMat<N, 1>::zeros();
+		errorCov = transition = FixedMat<N, N>::identity();
+		processNoise = FixedMat<N, N>::zeros();
+		measurement = FixedMat<M, N>::identity();
+		measurementNoise = FixedMat<M, M>::identity();
+	}
+
+	const FixedMat<N, 1> &predict() {
+		state = transition * state;
+		errorCov = transition * errorCov * transition.t() + processNoise;
+		return state;
+	}
+
+	//false when the innovation covariance can't be inverted, the state is left as predicted
+	bool correct(const FixedMat<M, 1> &z) {
+		FixedMat<N, M> pht = errorCov * measurement.t();
+		FixedMat<M, M> s = measurement * pht + measurementNoise, sInv;
+		if (!invert(s, sInv))
+			return false;
+		FixedMat<N, M> gain = pht * sInv;
+		state = state + gain * (z - measurement * state);
+		errorCov = errorCov - gain * (measurement * errorCov);
+		//keep P symmetric against float rounding
+		for (int r = 0; r < N; r++)
+			for (int c = r + 1; c < N; c++)
+				errorCov.m[r][c] = errorCov.m[c][r] = 0.5f * (errorCov.m[r][c] + errorCov.m[c][r]);
+		return true;
+	}
+};
+
+//ORDER 1: constant velocity, 2: constant acceleration. 2 * (ORDER + 1) states, position measured
+template <int ORDER>
+class MotionKalman : public FixedKalman<2 * (ORDER + 1), 2> {
+public:
+	enum { STATES = 2 * (ORDER + 1) };
+	typedef FixedKalman<STATES, 2> Filter;
+
+	MotionKalman() : q(0) {}
+
+	/*
+	 * Starts at p at rest.
+	 * 		processNoise -> q, spectral density of the random acceleration (ORDER 1) or jerk (ORDER 2)
+	 * 		measurementNoise -> variance of a measured position, px^2
+	 * 		motionVariance -> starting variance of the velocity (and acceleration), nothing is known about them yet
+	 */
+	void init(Point2f p, float processNoise, float measurementNoise, float motionVariance) {
+		q = processNoise;
+		Filter::state = FixedMat<STATES, 1>::zeros();
+		Filter::state.m[0][0] = p.x;
+		Filter::state.m[1][0] = p.y;
+		Filter::errorCov = FixedMat<STATES, STATES>::identity(motionVariance);
+		Filter::errorCov.m[0][0] = Filter::errorCov.m[1][1] = measurementNoise;
+		Filter::measurement = FixedMat<2, STATES>::identity();
+		Filter::measurementNoise = FixedMat<2, 2>::identity(measurementNoise);
+		setInterval(0);
+	}
+
+	//transition and process noise for dt seconds
+	void setInterval(float dt) {
+		//derivative j feeds every lower derivative i by dt^(j - i) / (j - i)!
+		Filter::transition = FixedMat<STATES, STATES>::identity();
+		Filter::processNoise = FixedMat<STATES, STATES>::zeros();
+		for (int i = 0; i <= ORDER; i++) {
+			for (int j = 0; j <= ORDER; j++) {
+				if (j > i) {
+					float f = powf(dt, float(j - i)) / factorial(j - i);
+					Filter::transition.m[2 * i][2 * j] = Filter::transition.m[2 * i + 1][2 * j + 1] = f;
+				}
+				//white noise on the highest derivative: Q_ij = q dt^k / ((ORDER - i)! (ORDER - j)! k), k = 2 ORDER + 1 - i - j
+				int k = 2 * ORDER + 1 - i - j;
+				float n = q * powf(dt, float(k)) / (factorial(ORDER - i) * factorial(ORDER - j) * k);
+				Filter::processNoise.m[2 * i][2 * j] = Filter::processNoise.m[2 * i + 1][2 * j + 1] = n;
+			}
+		}
+	}
+
+	//dt <= 0 (a repeated or paused frame) leaves the state where it is
+	const FixedMat<STATES, 1> &predict(float dt) {
+		if (dt <= 0)
+			return Filter::state;
+		setInterval(dt);
+		return Filter::predict();
+	}
+
+	bool correct(Point2f p) {
+		FixedMat<2, 1> z;
+		z.m[0][0] = p.x;
+		z.m[1][0] = p.y;
+		return Filter::correct(z);
+	}
+
+	Point2f position() const { return Point2f(Filter::state.m[0][0], Filter::state.m[1][0]); }
+	Point2f velocity() const { return Point2f(Filter::state.m[2][0], Filter::state.m[3][0]); }
+	//standard deviation of the position along the less certain axis, px
+	float positionSigma() const { return sqrtf(std::max(Filter::errorCov.m[0][0], Filter::errorCov.m[1][1])); }
+
+private:
+	static float factorial(int n) {
+		float f = 1;
+		for (int i = 2; i <= n; i++)
+			f *= i;
+		return f;
+	}
+
+	float q;
+};
+
+typedef MotionKalman<1> ConstantVelocityKalman;
+typedef MotionKalman<2> ConstantAccelerationKalman;
+#endif
@@ -0,0 +1,182 @@
+/*
+ * Stage latency histograms
+ * Description:
+ * Bucket maths, per thread histogram selection, the stage registry and the
+ * dump. See latency.h.
+ */
+#include "latency.h"
+#include <time.h>
+#include <mutex>
+#include <limits>
+
+int64_t monotonicMicros() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+LatencySnapshot::LatencySnapshot() : count(0), min(0), max(0), total(0) {
+	for (int i = 0; i < LATENCY_BUCKETS; i++)
+		buckets[i] = 0;
+}
+
+int64_t LatencySnapshot::percentile(double p) const {
+	if (count == 0)
+		return 0;
+	if (p >= 100)
+		return max;
+	uint64_t rank = uint64_t(p / 100.0 * count);
+	uint64_t seen = 0;
+	for (int i = 0; i < LATENCY_BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen > rank) {
+			int64_t upper = i + 1 < LATENCY_BUCKETS ? LatencyHistogram::bucketStart(i + 1) - 1 : max;
+			return upper < max ? upper : max;
+		}
+	}
+	return max;
+}
+
+LatencyHistogram::LatencyHistogram() {
+	reset();
+}
+
+void LatencyHistogram::reset() {
+	for (int i = 0; i < LATENCY_BUCKETS; i++)
+		counts[i].store(0, std::memory_order_relaxed);
+	minValue.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+	maxValue.store(0, std::memory_order_relaxed);
+	total.store(0, std::memory_order_relaxed);
+}
+
+/*
+ * below 16us one bucket per microsecond, above that 16 buckets per power of two
+ */
+int LatencyHistogram::bucketOf(int64_t micros) {
+	if (micros < LATENCY_SUB_BUCKETS)
+		return micros < 0 ? 0 : int(micros);
+	int msb = 63 - __builtin_clzll((unsigned long long)micros);
+	int bucket = (msb - 3) * LATENCY_SUB_BUCKETS + int((micros >> (msb - 4)) & (LATENCY_SUB_BUCKETS - 1));
+	return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+int64_t LatencyHistogram::bucketStart(int bucket) {
+	if (bucket < LATENCY_SUB_BUCKETS)
+		return bucket;
+	int octave = bucket / LATENCY_SUB_BUCKETS;
+	int sub = bucket % LATENCY_SUB_BUCKETS;
+	return int64_t(LATENCY_SUB_BUCKETS + sub) << (octave - 1);
+}
+
+void LatencyHistogram::record(int64_t micros) {
+	counts[bucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+	total.fetch_add(micros, std::memory_order_relaxed);
+	int64_t current = minValue.load(std::memory_order_relaxed);
+	while (micros < current && !minValue.compare_exchange_weak(current, micros, std::memory_order_relaxed))
+		;
+	current = maxValue.load(std::memory_order_relaxed);
+	while (micros > current && !maxValue.compare_exchange_weak(current, micros, std::memory_order_relaxed))
+		;
+}
+
+void LatencyHistogram::addTo(LatencySnapshot &snapshot) const {
+	uint64_t n = 0;
+	for (int i = 0; i < LATENCY_BUCKETS; i++) {
+		uint32_t c = counts[i].load(std::memory_order_relaxed);
+		snapshot.buckets[i] += c;
+		n += c;
+	}
+	if (n == 0)
+		return;
+	int64_t lo = minValue.load(std::memory_order_relaxed);
+	int64_t hi = maxValue.load(std::memory_order_relaxed);
+	if (snapshot.count == 0 || lo < snapshot.min)
+		snapshot.min = lo;
+	if (hi > snapshot.max)
+		snapshot.max = hi;
+	snapshot.count += n;
+	snapshot.total += total.load(std::memory_order_relaxed);
+}
+
+static std::mutex &registryLock() {
+	static std::mutex lock;
+	return lock;
+}
+
+static vector<LatencyStage *> &registry() {
+	static vector<LatencyStage *> stages;
+	return stages;
+}
+
+//each thread gets the next histogram slot the first time it records anything
+static std::atomic<int> nextThreadSlot(0);
+static thread_local int threadSlot = -1;
+
+LatencyStage::LatencyStage(const string &name) : stageName(name) {
+	histograms = new LatencyHistogram[MAX_LATENCY_THREADS];
+	std::lock_guard<std::mutex> guard(registryLock());
+	registry().push_back(this);
+}
+
+LatencyStage::~LatencyStage() {
+	{
+		std::lock_guard<std::mutex> guard(registryLock());
+		vector<LatencyStage *> &stages = registry();
+		for (size_t i = 0; i < stages.size(); i++) {
+			if (stages[i] == this) {
+				stages.erase(stages.begin() + i);
+				break;
+			}
+		}
+	}
+	delete[] histograms;
+}
+
+LatencyHistogram &LatencyStage::local() {
+	if (threadSlot < 0) {
+		threadSlot = nextThreadSlot.fetch_add(1);
+		if (threadSlot >= MAX_LATENCY_THREADS)
+			threadSlot = MAX_LATENCY_THREADS - 1;
+	}
+	return histograms[threadSlot];
+}
+
+LatencySnapshot LatencyStage::snapshot() const {
+	LatencySnapshot s;
+	s.name = stageName;
+	for (int i = 0; i < MAX_LATENCY_THREADS; i++)
+		histograms[i].addTo(s);
+	return s;
+}
+
+void LatencyStage::reset() {
+	for (int i = 0; i < MAX_LATENCY_THREADS; i++)
+		histograms[i].reset();
+}
+
+vector<LatencySnapshot> snapshotLatencies() {
+	std::lock_guard<std::mutex> guard(registryLock());
+	vector<LatencySnapshot> snapshots;
+	for (size_t i = 0; i < registry().size(); i++)
+		snapshots.push_back(registry()[i]->snapshot());
+	return snapshots;
+}
+
+void dumpLatencyStats(FILE *out) {
+	vector<LatencySnapshot> snapshots = snapshotLatencies();
+	fprintf(out, "%-20s %8s %8s %8s %8s %8s %8s %10s  (us)\n", "stage", "count", "min", "p50", "p90", "p99", "max", "mean");
+	for (size_t i = 0; i < snapshots.size(); i++) {
+		const LatencySnapshot &s = snapshots[i];
+		if (s.count == 0)
+			continue;
+		fprintf(out, "%-20s %8llu %8lld %8lld %8lld %8lld %8lld %10.1f\n", s.name.c_str(),
+				(unsigned long long)s.count, (long long)s.min, (long long)s.percentile(50),
+				(long long)s.percentile(90), (long long)s.percentile(99), (long long)s.max, s.mean());
+	}
+}
+
+void resetLatencyStats() {
+	std::lock_guard<std::mutex> guard(registryLock());
+	for (size_t i = 0; i < registry().size(); i++)
+		registry()[i]->reset();
+}
@@ -0,0 +1,123 @@
+/*
+ * Stage latency histograms header file
+ * Description:
+ * Replaces the gettimeofday/getTimeDelta/recordTime globals every program
+ * had. A LatencyStage is a named stage (capture, detect, display, ...) with
+ * one fixed bucket histogram per thread that records into it, so recording
+ * never takes a lock or shares a cache line with another thread. A snapshot
+ * adds the per thread histograms up and gives count, min, p50, p90, p99,
+ * max and mean. Means hide the slow frames that miss a control deadline,
+ * the percentiles don't.
+ *
+ * Buckets are 16 per power of two of microseconds (at most 1/16 = 6%
+ * relative error) from 1us up to 2^31us, about 36 minutes. Anything longer
+ * is counted in the last bucket, min, max and mean stay exact.
+ *
+ * Usage:
+ *    LatencyStage detectLatency("detect");
+ *    ...
+ *    {
+ *        ScopedLatency timer(detectLatency);
+ *        ... work ...
+ *    } //or timer.stop() to get the time back
+ *    dumpLatencyStats(stdout);
+ *
+ * Note:
+ * - Stages are meant to be globals that live as long as the program, they
+ *   register themselves so dumpLatencyStats() finds them.
+ * - Up to MAX_LATENCY_THREADS threads get their own histogram, any more share
+ *   the last one (still correct, the counters are atomic).
+ * - Needs C++11 (-std=c++11) for thread_local and std::atomic.
+ */
+#ifndef LATENCY_INCLUDED
+#define LATENCY_INCLUDED
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+using namespace std;
+
+const int MAX_LATENCY_THREADS = 16;
+const int LATENCY_SUB_BUCKETS = 16;
+const int LATENCY_BUCKETS = 28 * LATENCY_SUB_BUCKETS;
+
+//microseconds from a monotonic clock, only differences mean anything
+int64_t monotonicMicros();
+
+struct LatencySnapshot {
+	string name;
+	uint64_t count;
+	int64_t min, max;
+	int64_t total;
+	uint64_t buckets[LATENCY_BUCKETS];
+
+	LatencySnapshot();
+	double mean() const { return count ? double(total) / count : 0; }
+	//upper edge of the bucket holding the p-th percentile (0..100), exact max for 100
+	int64_t percentile(double p) const;
+};
+
+class LatencyHistogram {
+public:
+	LatencyHistogram();
+
+	void record(int64_t micros);
+	void addTo(LatencySnapshot &snapshot) const;
+	void reset();
+
+	static int bucketOf(int64_t micros);
+	//smallest value that falls in bucket
+	static int64_t bucketStart(int bucket);
+
+private:
+	std::atomic<uint32_t> counts[LATENCY_BUCKETS];
+	std::atomic<int64_t> minValue, maxValue, total;
+};
+
+class LatencyStage {
+public:
+	LatencyStage(const string &name);
+	~LatencyStage();
+
+	const string &name() const { return stageName; }
+	void record(int64_t micros) { local().record(micros); }
+	LatencySnapshot snapshot() const;
+	void reset();
+
+private:
+	LatencyHistogram &local();
+
+	string stageName;
+	LatencyHistogram *histograms; //MAX_LATENCY_THREADS of them
+};
+
+class ScopedLatency {
+public:
+	ScopedLatency(LatencyStage &stage) : stage(stage), start(monotonicMicros()), running(true) {}
+	~ScopedLatency() { stop(); }
+
+	//records the time since construction once and returns it
+	long stop() {
+		if (running) {
+			elapsed = long(monotonicMicros() - start);
+			stage.record(elapsed);
+			running = false;
+		}
+		return elapsed;
+	}
+
+private:
+	LatencyStage &stage;
+	int64_t start;
+	long elapsed;
+	bool running;
+};
+
+//every registered stage, in the order they were made
+vector<LatencySnapshot> snapshotLatencies();
+//one line per stage with samples: count min p50 p90 p99 max mean, in microseconds
+void dumpLatencyStats(FILE *out);
+void resetLatencyStats();
+#endif
@@ -0,0 +1,152 @@
+/*
+ * Rectangular morphology
+ * Description:
+ * van Herk/Gil-Werman row and column passes. See morphology.h.
+ * Note:
+ * - A window of length w around pixel x covers [x - before, x + after]. The
+ *   line is padded with before pixels in front and after pixels behind of the
+ *   value that never wins (255 for min, 0 for max) and cut into blocks of w.
+ *   g runs from the start of each block to the right, h from the end of each
+ *   block to the left, and the window starting at padded index i is
+ *   op(h[i], g[i + w - 1]).
+ * - The column pass works on whole rows of a strip at a time so the inner
+ *   loops run along memory and the compiler can vectorise them.
+ */
+#include "morphology.h"
+#include <algorithm>
+#include <string.h>
+
+//columns per strip of the column pass are a multiple of this
+static const int STRIP_ALIGN = 16;
+
+struct MinOp {
+	uchar operator()(uchar a, uchar b) const { return a < b ? a : b; }
+};
+
+struct MaxOp {
+	uchar operator()(uchar a, uchar b) const { return a > b ? a : b; }
+};
+
+template<class Op> static void combineLine(const uchar *a, const uchar *b, uchar *out, int n) {
+	Op op;
+	for (int x = 0; x < n; x++)
+		out[x] = op(a[x], b[x]);
+}
+
+template<class Op> static void rowPass(const Mat &src, Mat &dst, int before, int after, int rowStart, int rowEnd,
+		uchar neutral, vector<uchar> &buffer) {
+	Op op;
+	int n = src.cols, w = before + after + 1, len = n + w - 1;
+	buffer.resize(3 * len);
+	uchar *p = &buffer[0], *g = p + len, *h = g + len;
+	memset(p, neutral, before);
+	memset(p + before + n, neutral, after);
+	for (int y = rowStart; y < rowEnd; y++) {
+		memcpy(p + before, src.ptr<uchar>(y), n);
+		for (int start = 0; start < len; start += w) {
+			int end = min(start + w, len) - 1;
+			g[start] = p[start];
+			for (int i = start + 1; i <= end; i++)
+				g[i] = op(g[i - 1], p[i]);
+			h[end] = p[end];
+			for (int i = end - 1; i >= start; i--)
+				h[i] = op(h[i + 1], p[i]);
+		}
+		combineLine<Op>(h, g + w - 1, dst.ptr<uchar>(y), n);
+	}
+}
+
+template<class Op> static void columnPass(Mat &img, int before, int after, int colStart, int colEnd,
+		const uchar *neutralRow, vector<uchar> &buffer) {
+	int rows = img.rows, sw = colEnd - colStart, w = before + after + 1, len = rows + w - 1;
+	buffer.resize(size_t(2) * len * sw);
+	uchar *g = &buffer[0], *h = g + size_t(len) * sw;
+	for (int i = 0; i < len; i++) {
+		int y = i - before;
+		const uchar *p = y >= 0 && y < rows ? img.ptr<uchar>(y) + colStart : neutralRow;
+		uchar *gi = g + size_t(i) * sw;
+		if (i % w == 0)
+			memcpy(gi, p, sw);
+		else
+			combineLine<Op>(gi - sw, p, gi, sw);
+	}
+	for (int i = len - 1; i >= 0; i--) {
+		int y = i - before;
+		const uchar *p = y >= 0 && y < rows ? img.ptr<uchar>(y) + colStart : neutralRow;
+		uchar *hi = h + size_t(i) * sw;
+		if (i == len - 1 || i % w == w - 1)
+			memcpy(hi, p, sw);
+		else
+			combineLine<Op>(hi + sw, p, hi, sw);
+	}
+	//every row of the strip is in g and h now, writing over the input is fine
+	for (int y = 0; y < rows; y++)
+		combineLine<Op>(h + size_t(y) * sw, g + size_t(y + w - 1) * sw, img.ptr<uchar>(y) + colStart, sw);
+}
+
+Size mergedElement(Size element, int iterations) {
+	if (iterations <= 0)
+		return Size(1, 1);
+	return Size(iterations * (element.width - 1) + 1, iterations * (element.height - 1) + 1);
+}
+
+Morphology::Morphology(int threads) : pool(threads) {
+}
+
+void Morphology::apply(const Mat &src, Mat &dst, Size element, int iterations, bool isMax) {
+	CV_Assert(src.type() == CV_8UC1 && element.width > 0 && element.height > 0);
+	iterations = max(iterations, 0);
+	//anchored in the middle like getStructuringElement, n passes add up their reach
+	int left = iterations * (element.width / 2), right = iterations * (element.width - 1 - element.width / 2);
+	int up = iterations * (element.height / 2), down = iterations * (element.height - 1 - element.height / 2);
+	uchar neutral = isMax ? 0 : 255;
+
+	if (left + right == 0) {
+		if (dst.data != src.data)
+			src.copyTo(dst);
+	} else {
+		dst.create(src.size(), CV_8UC1);
+		int bands = min(src.rows, pool.size() * 4);
+		buffers.resize(max<size_t>(buffers.size(), bands));
+		pool.parallelFor(bands, [&](int b) {
+			int rowStart = src.rows * b / bands, rowEnd = src.rows * (b + 1) / bands;
+			if (isMax)
+				rowPass<MaxOp>(src, dst, left, right, rowStart, rowEnd, neutral, buffers[b]);
+			else
+				rowPass<MinOp>(src, dst, left, right, rowStart, rowEnd, neutral, buffers[b]);
+		});
+	}
+	if (up + down == 0)
+		return;
+
+	int cols = dst.cols;
+	identity.assign(cols, neutral);
+	int stripCols = max(STRIP_ALIGN, (cols / (pool.size() * 2) + STRIP_ALIGN - 1) / STRIP_ALIGN * STRIP_ALIGN);
+	int strips = (cols + stripCols - 1) / stripCols;
+	buffers.resize(max<size_t>(buffers.size(), strips));
+	pool.parallelFor(strips, [&](int s) {
+		int colStart = s * stripCols, colEnd = min(cols, colStart + stripCols);
+		if (isMax)
+			columnPass<MaxOp>(dst, up, down, colStart, colEnd, &identity[0], buffers[s]);
+		else
+			columnPass<MinOp>(dst, up, down, colStart, colEnd, &identity[0], buffers[s]);
+	});
+}
+
+void Morphology::erode(const Mat &src, Mat &dst, Size element, int iterations) {
+	apply(src, dst, element, iterations, false);
+}
+
+void Morphology::dilate(const Mat &src, Mat &dst, Size element, int iterations) {
+	apply(src, dst, element, iterations, true);
+}
+
+void Morphology::open(const Mat &src, Mat &dst, Size element, int iterations) {
+	apply(src, dst, element, iterations, false);
+	apply(dst, dst, element, iterations, true);
+}
+
+void Morphology::close(const Mat &src, Mat &dst, Size element, int iterations) {
+	apply(src, dst, element, iterations, true);
+	apply(dst, dst, element, iterations, false);
+}
@@ -0,0 +1,63 @@
+/*
+ * Rectangular morphology header file
+ * Description:
+ * Erode, dilate, open and close of 8 bit single channel images (binary masks
+ * included) with rectangular elements, using the van Herk/Gil-Werman running
+ * min/max. A rectangle is a row pass and a column pass, and each pass cuts
+ * the line into blocks the size of the element, keeps a running min (or max)
+ * from the left and from the right inside every block and combines one of
+ * each per pixel. That is three compares per pixel and pass whatever the
+ * size of the element, where erode/dilate cost grows with it.
+ *
+ * Repeating an operation n times with a w x h rectangle is the same as doing
+ * it once with a (n(w-1)+1) x (n(h-1)+1) one, so iterations are merged into
+ * one pass instead of run n times. The row pass is split into bands of rows
+ * and the column pass into strips of columns, both spread over a thread pool.
+ *
+ * Results are the same as cv::erode/cv::dilate/cv::morphologyEx with
+ * getStructuringElement(MORPH_RECT, size) and the default anchor and border:
+ * pixels outside the image never change the result.
+ *
+ * Usage:
+ *    Morphology morph;
+ *    morph.erode(mask, mask, Size(3, 3), 2);
+ *    morph.open(gray, gray, Size(5, 5));
+ *
+ * Note:
+ * - src and dst may be the same Mat.
+ * - One call at a time per Morphology, keep one per thread that uses it.
+ * - Needs C++11 (-std=c++11 -pthread) for the thread pool.
+ */
+#ifndef MORPHOLOGY_INCLUDED
+#define MORPHOLOGY_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "threadPool.h"
+
+using namespace std;
+using namespace cv;
+
+//the single rectangle that does what iterations passes of element do
+Size mergedElement(Size element, int iterations);
+
+class Morphology {
+public:
+	//threads counts the calling thread, 0 uses every core
+	Morphology(int threads = 0);
+
+	void erode(const Mat &src, Mat &dst, Size element, int iterations = 1);
+	void dilate(const Mat &src, Mat &dst, Size element, int iterations = 1);
+	//erode then dilate, and the other way round, like morphologyEx
+	void open(const Mat &src, Mat &dst, Size element, int iterations = 1);
+	void close(const Mat &src, Mat &dst, Size element, int iterations = 1);
+
+	int threads() const { return pool.size(); }
+
+private:
+	void apply(const Mat &src, Mat &dst, Size element, int iterations, bool isMax);
+
+	ThreadPool pool;
+	vector< vector<uchar> > buffers;  //running min/max lines, one per task
+	vector<uchar> identity;           //a row of the value that never wins
+};
+#endif
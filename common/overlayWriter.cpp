@@ -0,0 +1,220 @@
+/*
+ * Overlay writer
+ * Description:
+ * Overlay primitives, their text format and the background writer. See
+ * overlayWriter.h.
+ */
+#include "overlayWriter.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <stdio.h>
+#include <string.h>
+
+void Overlay::addRect(Rect r, Scalar color, int thickness) {
+	OverlayPrimitive p;
+	p.kind = OverlayPrimitive::RECT;
+	p.position = Point2f(r.x, r.y);
+	p.size = Size2f(r.width, r.height);
+	p.radius = 0;
+	p.color = color;
+	p.thickness = thickness;
+	primitives.push_back(p);
+}
+
+void Overlay::addCircle(Point2f center, float radius, Scalar color, int thickness) {
+	OverlayPrimitive p;
+	p.kind = OverlayPrimitive::CIRCLE;
+	p.position = center;
+	p.radius = radius;
+	p.color = color;
+	p.thickness = thickness;
+	primitives.push_back(p);
+}
+
+void Overlay::addLabel(Point2f position, const string &text, Scalar color) {
+	OverlayPrimitive p;
+	p.kind = OverlayPrimitive::LABEL;
+	p.position = position;
+	p.radius = 0;
+	p.color = color;
+	p.thickness = 1;
+	p.text = text;
+	primitives.push_back(p);
+}
+
+void Overlay::render(Mat &image) const {
+	for (size_t i = 0; i < primitives.size(); i++) {
+		const OverlayPrimitive &p = primitives[i];
+		switch (p.kind) {
+		case OverlayPrimitive::RECT:
+			rectangle(image, Rect(int(p.position.x), int(p.position.y), int(p.size.width), int(p.size.height)),
+					p.color, p.thickness);
+			break;
+		case OverlayPrimitive::CIRCLE:
+			circle(image, Point(cvRound(p.position.x), cvRound(p.position.y)), cvRound(p.radius), p.color, p.thickness);
+			break;
+		case OverlayPrimitive::LABEL:
+			putText(image, p.text, Point(cvRound(p.position.x), cvRound(p.position.y)), FONT_HERSHEY_SIMPLEX, 0.5,
+					p.color, p.thickness);
+			break;
+		}
+	}
+}
+
+bool Overlay::save(const string &path) const {
+	FILE *file = fopen(path.c_str(), "w");
+	if (!file) {
+		perror(path.c_str());
+		return false;
+	}
+	fprintf(file, "overlay 1\nsource %s\nsize %d %d\n", source.c_str(), size.width, size.height);
+	for (size_t i = 0; i < primitives.size(); i++) {
+		const OverlayPrimitive &p = primitives[i];
+		int b = int(p.color[0]), g = int(p.color[1]), r = int(p.color[2]);
+		switch (p.kind) {
+		case OverlayPrimitive::RECT:
+			fprintf(file, "rect %g %g %g %g %d %d %d %d\n", p.position.x, p.position.y,
+					p.size.width, p.size.height, b, g, r, p.thickness);
+			break;
+		case OverlayPrimitive::CIRCLE:
+			fprintf(file, "circle %.2f %.2f %.2f %d %d %d %d\n", p.position.x, p.position.y, p.radius,
+					b, g, r, p.thickness);
+			break;
+		case OverlayPrimitive::LABEL:
+			fprintf(file, "label %.2f %.2f %d %d %d %s\n", p.position.x, p.position.y, b, g, r, p.text.c_str());
+			break;
+		}
+	}
+	return fclose(file) == 0;
+}
+
+bool Overlay::load(const string &path) {
+	FILE *file = fopen(path.c_str(), "r");
+	if (!file) {
+		perror(path.c_str());
+		return false;
+	}
+	source.clear();
+	size = Size();
+	primitives.clear();
+
+	char line[4096];
+	int version = 0;
+	bool ok = fgets(line, sizeof(line), file) && sscanf(line, "overlay %d", &version) == 1 && version == 1;
+	while (ok && fgets(line, sizeof(line), file)) {
+		line[strcspn(line, "\r\n")] = 0;
+		float x, y, a, c, radius;
+		int b, g, r, thickness, textStart = 0;
+		if (!strncmp(line, "source ", 7)) {
+			source = line + 7;
+		} else if (sscanf(line, "size %d %d", &size.width, &size.height) == 2) {
+		} else if (sscanf(line, "rect %f %f %f %f %d %d %d %d", &x, &y, &a, &c, &b, &g, &r, &thickness) == 8) {
+			addRect(Rect(int(x), int(y), int(a), int(c)), Scalar(b, g, r), thickness);
+		} else if (sscanf(line, "circle %f %f %f %d %d %d %d", &x, &y, &radius, &b, &g, &r, &thickness) == 7) {
+			addCircle(Point2f(x, y), radius, Scalar(b, g, r), thickness);
+		} else if (sscanf(line, "label %f %f %d %d %d %n", &x, &y, &b, &g, &r, &textStart) == 5 && textStart > 0) {
+			addLabel(Point2f(x, y), line + textStart, Scalar(b, g, r));
+		} else if (line[0]) {
+			fprintf(stderr, "%s: can't read \"%s\"\n", path.c_str(), line);
+			ok = false;
+		}
+	}
+	fclose(file);
+	return ok;
+}
+
+bool renderOverlayFile(const string &overlayPath, const string &out) {
+	Overlay overlay;
+	if (!overlay.load(overlayPath))
+		return false;
+	Mat image = imread(overlay.source, CV_LOAD_IMAGE_COLOR);
+	if (image.empty()) {
+		fprintf(stderr, "%s: can't read the source frame %s\n", overlayPath.c_str(), overlay.source.c_str());
+		return false;
+	}
+	overlay.render(image);
+	vector<int> compression_params;
+	compression_params.push_back(CV_IMWRITE_JPEG_QUALITY);
+	compression_params.push_back(OVERLAY_JPEG_QUALITY);
+	return imwrite(out, image, compression_params);
+}
+
+OverlayWriter::OverlayWriter(int threads, int depth) :
+		depth(depth > 0 ? depth : 1), busy(0), stopping(false), nWritten(0), nFailed(0) {
+	for (int i = 0; i < threads || i == 0; i++)
+		workers.push_back(std::thread(&OverlayWriter::workerLoop, this));
+}
+
+OverlayWriter::~OverlayWriter() {
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		stopping = true;
+	}
+	notEmpty.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void OverlayWriter::push(Job &job) {
+	std::unique_lock<std::mutex> guard(lock);
+	while ((int)jobs.size() >= depth)
+		notFull.wait(guard);
+	jobs.push_back(Job());
+	std::swap(jobs.back(), job);
+	notEmpty.notify_one();
+}
+
+void OverlayWriter::submitImage(const string &path, const Mat &image) {
+	Job job;
+	job.path = path;
+	job.image = image;
+	job.compact = false;
+	push(job);
+}
+
+void OverlayWriter::submitOverlay(const string &path, const Overlay &overlay) {
+	Job job;
+	job.path = path;
+	job.overlay = overlay;
+	job.compact = true;
+	push(job);
+}
+
+void OverlayWriter::flush() {
+	std::unique_lock<std::mutex> guard(lock);
+	while (!jobs.empty() || busy > 0)
+		idle.wait(guard);
+}
+
+void OverlayWriter::workerLoop() {
+	vector<int> compression_params;
+	compression_params.push_back(CV_IMWRITE_JPEG_QUALITY);
+	compression_params.push_back(OVERLAY_JPEG_QUALITY);
+
+	std::unique_lock<std::mutex> guard(lock);
+	for (;;) {
+		while (jobs.empty() && !stopping)
+			notEmpty.wait(guard);
+		//what is still queued gets written before the writer goes away
+		if (jobs.empty())
+			return;
+		Job job;
+		std::swap(job, jobs.front());
+		jobs.pop_front();
+		++busy;
+		notFull.notify_one();
+
+		guard.unlock();
+		bool ok = job.compact ? job.overlay.save(job.path) : imwrite(job.path, job.image, compression_params);
+		job.image.release();
+		guard.lock();
+
+		--busy;
+		if (ok)
+			++nWritten;
+		else
+			++nFailed;
+		if (jobs.empty() && busy == 0)
+			idle.notify_all();
+	}
+}
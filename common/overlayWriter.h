@@ -0,0 +1,111 @@
+/*
+ * Overlay writer header file
+ * Description:
+ * Gets saving annotated output off the thread that detects.
+ *
+ * Overlay - what gets drawn on a frame (rectangles, circles, text labels) as
+ *   a list of primitives plus the path of the frame it belongs to. render()
+ *   draws it on an image, save()/load() keep it as a small text file:
+ *      overlay 1
+ *      source <path of the frame>
+ *      size <width> <height>
+ *      rect <x> <y> <w> <h> <b> <g> <r> <thickness>
+ *      circle <x> <y> <radius> <b> <g> <r> <thickness>
+ *      label <x> <y> <b> <g> <r> <text to the end of the line>
+ * OverlayWriter - worker threads behind a bounded queue that encode and
+ *   write images (full mode) or save overlays (compact mode, a few hundred
+ *   bytes instead of a full resolution JPEG). submit() only waits when the
+ *   queue is full, so a slow disk slows the producers down instead of
+ *   piling up frames in memory.
+ *
+ * Usage:
+ *    OverlayWriter writer;
+ *    writer.submitImage("out/a.jpg", overlayImage);  //the Mat is shared, don't draw on it afterwards
+ *    writer.submitOverlay("out/a.jpg.overlay", overlay);
+ *    writer.flush(); //waits until everything is on disk
+ *
+ * Note:
+ * - A compact overlay is turned into an image later with renderOverlayFile().
+ * - Needs C++11 (-std=c++11 -pthread).
+ */
+#ifndef OVERLAY_WRITER_INCLUDED
+#define OVERLAY_WRITER_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+using namespace cv;
+
+const int OVERLAY_QUEUE_DEPTH = 8;
+const int OVERLAY_WRITER_THREADS = 2;
+const int OVERLAY_JPEG_QUALITY = 100;
+
+struct OverlayPrimitive {
+	enum Kind { RECT, CIRCLE, LABEL };
+	int kind;
+	Point2f position;   //centre of a circle, corner of a rect, baseline start of a label
+	Size2f size;        //rect size
+	float radius;
+	Scalar color;
+	int thickness;
+	string text;
+};
+
+class Overlay {
+public:
+	string source;
+	Size size;
+	vector<OverlayPrimitive> primitives;
+
+	void clear() { primitives.clear(); }
+	void addRect(Rect r, Scalar color, int thickness = 1);
+	void addCircle(Point2f center, float radius, Scalar color, int thickness = 1);
+	void addLabel(Point2f position, const string &text, Scalar color);
+
+	void render(Mat &image) const;
+	bool save(const string &path) const;
+	bool load(const string &path);
+};
+
+//loads the overlay and its source frame and writes the rendered result to out
+bool renderOverlayFile(const string &overlayPath, const string &out);
+
+class OverlayWriter {
+public:
+	OverlayWriter(int threads = OVERLAY_WRITER_THREADS, int depth = OVERLAY_QUEUE_DEPTH);
+	~OverlayWriter();
+
+	void submitImage(const string &path, const Mat &image);
+	void submitOverlay(const string &path, const Overlay &overlay);
+	//returns once every submitted job is written
+	void flush();
+
+	int written() const { return nWritten; }
+	int failed() const { return nFailed; }
+
+private:
+	struct Job {
+		string path;
+		Mat image;
+		Overlay overlay;
+		bool compact;
+	};
+
+	void push(Job &job);
+	void workerLoop();
+
+	vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable notEmpty, notFull, idle;
+	deque<Job> jobs;
+	int depth;
+	int busy;           //jobs taken off the queue and not written yet
+	bool stopping;
+	int nWritten, nFailed;
+};
+#endif
@@ -0,0 +1,175 @@
+/*
+ * Parameter sweep
+ * Description:
+ * Grid walking, the staged per image work and ranking. See paramSweep.h.
+ */
+#include "paramSweep.h"
+#include "detectionLog.h"
+#include "latency.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+SweepGrid::SweepGrid(double roundness) {
+	BalloonynessParams defaults;
+	hueCenters.push_back(defaults.hueCenter);
+	hueDivisors.push_back(defaults.hueDivisor);
+	satDivisors.push_back(defaults.satDivisor);
+	thresholds.push_back(defaults.threshold);
+	minRoundness.push_back(roundness);
+}
+
+int SweepGrid::size() const {
+	return int(hueCenters.size() * hueDivisors.size() * satDivisors.size() * thresholds.size() * minRoundness.size());
+}
+
+bool parseSweepValues(const char *spec, vector<double> &values) {
+	vector<double> parsed;
+	char *end;
+	double first = strtod(spec, &end);
+	if (end == spec)
+		return false;
+	if (*end == ':') {
+		double last = strtod(end + 1, &end);
+		double step = *end == ':' ? strtod(end + 1, &end) : 1;
+		if (*end || step <= 0 || last < first)
+			return false;
+		//a little slack so 0.5:0.8:0.1 still ends on 0.8
+		for (int i = 0; first + i * step <= last + step * 1e-6; i++)
+			parsed.push_back(first + i * step);
+	} else {
+		parsed.push_back(first);
+		while (*end == ',') {
+			const char *next = end + 1;
+			parsed.push_back(strtod(next, &end));
+			if (end == next)
+				return false;
+		}
+		if (*end)
+			return false;
+	}
+	values = parsed;
+	return true;
+}
+
+static bool betterResult(const SweepResult &a, const SweepResult &b) {
+	if (a.match.found != b.match.found)
+		return a.match.found > b.match.found;
+	if (a.match.falsePositives != b.match.falsePositives)
+		return a.match.falsePositives < b.match.falsePositives;
+	if (a.match.meanError() != b.match.meanError())
+		return a.match.meanError() < b.match.meanError();
+	return a.labelMs < b.labelMs;
+}
+
+void rankSweepResults(vector<SweepResult> &results) {
+	stable_sort(results.begin(), results.end(), betterResult);
+}
+
+ParamSweep::ParamSweep(int threads) : pool(threads) {
+}
+
+void ParamSweep::addImage(const Mat &bgr, const vector<BalloonLabel> &imageLabels) {
+	CV_Assert(bgr.type() == CV_8UC3);
+	//the same integer conversion the balloonyness kernels do
+	Mat packed(bgr.size(), CV_16UC1);
+	for (int y = 0; y < bgr.rows; y++) {
+		const uchar *in = bgr.ptr<uchar>(y);
+		ushort *out = packed.ptr<ushort>(y);
+		for (int x = 0; x < bgr.cols; x++, in += 3) {
+			int h, s, v;
+			bgrToHsv8u(in[0], in[1], in[2], h, s, v);
+			out[x] = ushort(h << 8 | s);
+		}
+	}
+	hs.push_back(packed);
+	labels.push_back(imageLabels);
+	++counts.colour;
+}
+
+/*
+ * one image under one set of score parameters: the score plane once, then
+ * every threshold and roundness below it. Only writes the grid entries of
+ * its own score parameters in perImage
+ */
+void ParamSweep::runTask(const SweepGrid &grid, int image, int scoreIndex, vector<SweepResult> &perImage) {
+	int nSd = (int)grid.satDivisors.size(), nHd = (int)grid.hueDivisors.size();
+	int nT = (int)grid.thresholds.size(), nR = (int)grid.minRoundness.size();
+	BalloonynessParams params;
+	params.hueCenter = cvRound(grid.hueCenters[scoreIndex / (nSd * nHd)]);
+	params.hueDivisor = cvRound(grid.hueDivisors[scoreIndex / nSd % nHd]);
+	params.satDivisor = cvRound(grid.satDivisors[scoreIndex % nSd]);
+
+	//score stage
+	vector<uchar> lut(1 << 16);
+	for (int h = 0; h < 256; h++)
+		for (int s = 0; s < 256; s++)
+			lut[h << 8 | s] = uchar(balloonynessHsScore(h, s, params));
+	const Mat &packed = hs[image];
+	Mat score(packed.size(), CV_8UC1);
+	for (int y = 0; y < packed.rows; y++) {
+		const ushort *in = packed.ptr<ushort>(y);
+		uchar *out = score.ptr<uchar>(y);
+		for (int x = 0; x < packed.cols; x++)
+			out[x] = lut[in[x]];
+	}
+
+	Mat mask;
+	BlobAnalyser analyser;
+	vector<Blob> blobs;
+	vector<Detection> detections;
+	for (int t = 0; t < nT; t++) {
+		//label stage, a pixel is a candidate when its score is above the threshold
+		params.threshold = cvRound(grid.thresholds[t]);
+		int64 start = monotonicMicros();
+		threshold(score, mask, params.threshold, 255, THRESH_BINARY);
+		analyser.analyse(mask, blobs);
+		double labelMs = (monotonicMicros() - start) / 1000.0;
+
+		//filter stage
+		for (int r = 0; r < nR; r++) {
+			SweepResult &result = perImage[(scoreIndex * nT + t) * nR + r];
+			result.params = params;
+			result.minRoundness = grid.minRoundness[r];
+			blobsToDetections(blobs, result.minRoundness, detections);
+			result.match = matchDetections(labels[image], detections);
+			result.images = 1;
+			result.candidates = (double)blobs.size();
+			result.labelMs = labelMs;
+		}
+	}
+}
+
+void ParamSweep::run(const SweepGrid &grid, vector<SweepResult> &results) {
+	int nImages = images();
+	int nScore = int(grid.hueCenters.size() * grid.hueDivisors.size() * grid.satDivisors.size());
+	int nLabel = (int)grid.thresholds.size();
+	vector< vector<SweepResult> > perImage(nImages, vector<SweepResult>(grid.size()));
+	pool.parallelFor(nImages * nScore, [&](int task) {
+		runTask(grid, task / nScore, task % nScore, perImage[task / nScore]);
+	});
+	counts.score = nImages * nScore;
+	counts.label = counts.score * nLabel;
+	counts.filter = nImages * grid.size();
+
+	//sums over the images, then per image averages of the costs
+	results.assign(grid.size(), SweepResult());
+	for (int i = 0; i < nImages; i++) {
+		for (size_t k = 0; k < results.size(); k++) {
+			const SweepResult &one = perImage[i][k];
+			results[k].params = one.params;
+			results[k].minRoundness = one.minRoundness;
+			results[k].images += one.images;
+			results[k].match.add(one.match);
+			results[k].candidates += one.candidates;
+			results[k].labelMs += one.labelMs;
+		}
+	}
+	for (size_t k = 0; k < results.size(); k++) {
+		if (results[k].images) {
+			results[k].candidates /= results[k].images;
+			results[k].labelMs /= results[k].images;
+		}
+	}
+}
@@ -0,0 +1,103 @@
+/*
+ * Parameter sweep header file
+ * Description:
+ * Runs the balloon detector over a grid of tuning parameters on a set of
+ * labelled images and scores every combination against the labels, so the
+ * constants (hue centre, hue and saturation divisors, threshold, roundness)
+ * can be picked from a table instead of by editing and rebuilding.
+ *
+ * Each stage is only rerun when a parameter it depends on changes:
+ *    colour   bgr -> packed hue/saturation plane           once per image
+ *    score    hue/sat -> balloonyness through a lookup     per hue centre and divisors
+ *    label    threshold + blob labelling                   per threshold
+ *    filter   roundness test + matching against labels     per roundness
+ * so a sweep over thresholds alone never converts colour again, and one over
+ * roundness alone never labels again. The (image, score parameters) pairs
+ * are the tasks spread over the thread pool.
+ *
+ * The mask is exactly what BalloonynessKernel gives for the same parameters,
+ * the score lookup is built from balloonynessHsScore().
+ *
+ * Usage:
+ *    ParamSweep sweep;
+ *    sweep.addImage(frame, labels);
+ *    SweepGrid grid(areaRatio);   //every list holds the current value to start with
+ *    parseSweepValues("150:250:10", grid.thresholds);
+ *    vector<SweepResult> results;
+ *    sweep.run(grid, results);
+ *    rankSweepResults(results);
+ *
+ * Note:
+ * - cost is what changes with the parameters: threshold plus labelling time
+ *   and the candidates left for the roundness test. Colour conversion costs
+ *   the same whatever the parameters are.
+ * - Needs C++11 (-std=c++11 -pthread) for the thread pool.
+ */
+#ifndef PARAM_SWEEP_INCLUDED
+#define PARAM_SWEEP_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "balloonyness.h"
+#include "groundTruth.h"
+#include "threadPool.h"
+
+using namespace std;
+using namespace cv;
+
+struct SweepGrid {
+	vector<double> hueCenters, hueDivisors, satDivisors, thresholds, minRoundness;
+
+	//the BalloonynessParams defaults and the given roundness
+	SweepGrid(double minRoundness);
+	int size() const;
+};
+
+struct SweepResult {
+	BalloonynessParams params;
+	double minRoundness;
+	int images;
+	MatchStats match;
+	double candidates;   //blobs per image before the roundness test
+	double labelMs;      //threshold + labelling per image
+
+	SweepResult() : minRoundness(0), images(0), candidates(0), labelMs(0) {}
+};
+
+//how often each stage ran in the last sweep
+struct SweepStageCounts {
+	int colour, score, label, filter;
+
+	SweepStageCounts() : colour(0), score(0), label(0), filter(0) {}
+};
+
+/*
+ * "a" for one value, "a,b,c" for a list, "first:last:step" for a range (last
+ * included). False on anything else or a step that isn't positive
+ */
+bool parseSweepValues(const char *spec, vector<double> &values);
+//most balloons found first, then fewest false positives, smallest error, lowest cost
+void rankSweepResults(vector<SweepResult> &results);
+
+class ParamSweep {
+public:
+	//threads counts the calling thread, 0 uses every core
+	ParamSweep(int threads = 0);
+
+	//converts the image once, bgr is not kept
+	void addImage(const Mat &bgr, const vector<BalloonLabel> &labels);
+	int images() const { return (int)hs.size(); }
+	int threads() const { return pool.size(); }
+
+	//one result per combination of the grid, in grid order
+	void run(const SweepGrid &grid, vector<SweepResult> &results);
+	const SweepStageCounts &stageCounts() const { return counts; }
+
+private:
+	void runTask(const SweepGrid &grid, int image, int scoreIndex, vector<SweepResult> &perImage);
+
+	ThreadPool pool;
+	vector<Mat> hs;                      //CV_16UC1, hue << 8 | saturation
+	vector< vector<BalloonLabel> > labels;
+	SweepStageCounts counts;
+};
+#endif
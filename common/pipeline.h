@@ -0,0 +1,146 @@
+/*
+ * Pipeline building blocks header file
+ * Description:
+ * Lock-free (unless a side sleeps) pieces used to join the stages of a capture/process/display
+ * pipeline that run on their own threads.
+ *
+ * LatestMailbox - single producer/single consumer "latest value wins" slot.
+ *   It is a triple buffer: the producer always has a slot to write into and
+ *   publishing never waits. If the consumer has not taken the last value yet
+ *   it is simply replaced, so a slow consumer skips stale frames instead of
+ *   building up a backlog. waitTake()/waitTaken() sleep on a condition
+ *   variable until the other side publishes or takes; publish() and take()
+ *   only touch the mutex while someone is waiting.
+ * SpscQueue - bounded single producer/single consumer ring. push() fails when
+ *   the ring is full, the producer decides whether to drop or retry.
+ *
+ * Note:
+ * - Values are handed over by slot. Anything a consumer keeps after the next
+ *   take()/pop() must be its own copy (clone a Mat, don't keep the header) or
+ *   the producer will write over it. A FrameView (frameSource.h) may be
+ *   kept as it is, it holds its own reference on the pixels.
+ * - Needs C++11 (-std=c++11) for std::atomic and std::condition_variable.
+ * - A waiter also wakes every MAILBOX_WAIT_MS to look at its keep going
+ *   flag, so a flag cleared from a signal handler (which can't notify) is
+ *   still seen. Call wakeAll() after clearing it anywhere else.
+ */
+#ifndef PIPELINE_INCLUDED
+#define PIPELINE_INCLUDED
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+//longest a mailbox waiter sleeps before looking at its keep going flag again
+const int MAILBOX_WAIT_MS = 50;
+
+template <typename T>
+class LatestMailbox {
+public:
+	LatestMailbox() : back(0), front(1), middle(2), waiters(0) {}
+
+	//producer side: write into writeSlot() then publish() it
+	T &writeSlot() { return slots[back]; }
+
+	//returns true if an unread value was replaced (a dropped frame)
+	bool publish() {
+		int old = middle.exchange(back | FRESH, std::memory_order_seq_cst);
+		back = old & INDEX;
+		notify();
+		return (old & FRESH) != 0;
+	}
+
+	//consumer side: take() returns false if nothing new was published since the last take
+	bool take() {
+		if (!(middle.load(std::memory_order_acquire) & FRESH))
+			return false;
+		int old = middle.exchange(front, std::memory_order_seq_cst);
+		front = old & INDEX;
+		notify();
+		return true;
+	}
+
+	//take() that sleeps until there is something to take, false if keepGoing was cleared first
+	bool waitTake(const std::atomic<bool> &keepGoing) {
+		while (!take()) {
+			if (!wait(keepGoing, true))
+				return false;
+		}
+		return true;
+	}
+
+	T &readSlot() { return slots[front]; }
+
+	//true while a published value hasn't been taken, a producer that must not drop can wait on it
+	bool pending() const { return (middle.load(std::memory_order_acquire) & FRESH) != 0; }
+	//producer side: sleeps until the last published value was taken, false if keepGoing was cleared first
+	bool waitTaken(const std::atomic<bool> &keepGoing) { return wait(keepGoing, false); }
+
+	//wakes both sides so they look at their keep going flags
+	void wakeAll() {
+		std::lock_guard<std::mutex> lock(mutex);
+		changed.notify_all();
+	}
+
+private:
+	enum { INDEX = 3, FRESH = 4 };
+
+	//sleeps until pending() is fresh, or false once keepGoing is cleared
+	bool wait(const std::atomic<bool> &keepGoing, bool fresh) {
+		//counted before pending() is looked at again, so a publish or take either sees the waiter or happened before the look
+		waiters.fetch_add(1, std::memory_order_seq_cst);
+		std::unique_lock<std::mutex> lock(mutex);
+		while (keepGoing && ((middle.load(std::memory_order_seq_cst) & FRESH) != 0) != fresh)
+			changed.wait_for(lock, std::chrono::milliseconds(MAILBOX_WAIT_MS));
+		waiters.fetch_sub(1, std::memory_order_relaxed);
+		return keepGoing;
+	}
+
+	void notify() {
+		if (waiters.load(std::memory_order_seq_cst) > 0)
+			wakeAll();
+	}
+
+	T slots[3];
+	int back;                 //only touched by the producer
+	int front;                //only touched by the consumer
+	std::atomic<int> middle;  //slot index plus FRESH when it holds an unread value
+	std::atomic<int> waiters; //threads in wait(), publish() and take() only notify when there are any
+	std::mutex mutex;
+	std::condition_variable changed;
+};
+
+template <typename T, unsigned N>
+class SpscQueue {
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	bool push(const T &value) {
+		unsigned t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == N)
+			return false;
+		items[t % N] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T &value) {
+		unsigned h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+		value = items[h % N];
+		items[h % N] = T(); //drop our reference before the slot is handed back
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	unsigned size() const {
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+private:
+	T items[N];
+	std::atomic<unsigned> head; //next slot to pop, written by the consumer
+	std::atomic<unsigned> tail; //next slot to push, written by the producer
+};
+#endif
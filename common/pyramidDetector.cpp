@@ -0,0 +1,117 @@
+/*
+ * Coarse to fine balloon detector
+ * Description:
+ * Scale selection, the coarse pass, fine window merging and the fine pass.
+ * See pyramidDetector.h.
+ */
+#include "pyramidDetector.h"
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+
+static bool firstPixelOrder(const Blob &a, const Blob &b) {
+	return a.first.y < b.first.y || (a.first.y == b.first.y && a.first.x < b.first.x);
+}
+
+PyramidDetector::PyramidDetector(BalloonDetector &detector, const PyramidParams &params) :
+		params(params), detector(detector), areaRadius(-1), areaFactor(-1), areaMin(1) {
+}
+
+int PyramidDetector::factor() const {
+	int f = 1;
+	while (f * 2 <= params.maxFactor && f * 2 <= params.minRadius)
+		f *= 2;
+	return f;
+}
+
+/*
+ * The fewest coarse samples a disk of minRadius covers wherever it sits on
+ * the sample grid, tried with its centre every 1/64 of a sample. A balloon
+ * that small has a ragged edge in the mask anyway, so the slivers between
+ * the centres tried don't matter
+ */
+int PyramidDetector::minCoarseArea() {
+	int f = factor();
+	if (params.minRadius == areaRadius && f == areaFactor)
+		return areaMin;
+	const int steps = 64;
+	float r = float(params.minRadius) / f;
+	int reach = (int)ceilf(r) + 1, fewest = INT_MAX;
+	//a quarter of the cell is enough, the grid is symmetric about its middle
+	for (int i = 0; i <= steps / 2; i++) {
+		for (int j = 0; j <= steps / 2; j++) {
+			float cx = float(i) / steps, cy = float(j) / steps;
+			int n = 0;
+			for (int y = -reach; y <= reach; y++)
+				for (int x = -reach; x <= reach; x++)
+					n += (x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r;
+			fewest = min(fewest, n);
+		}
+	}
+	areaRadius = params.minRadius;
+	areaFactor = f;
+	areaMin = max(fewest, 1);
+	return areaMin;
+}
+
+/*
+ * adds r to the window list, merging it with every window it touches
+ */
+void PyramidDetector::addWindow(Rect r) {
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		Rect grown(r.x - 1, r.y - 1, r.width + 2, r.height + 2);
+		for (size_t i = 0; i < windows.size(); i++) {
+			if ((grown & windows[i]).area() > 0) {
+				r |= windows[i];
+				windows[i] = windows.back();
+				windows.pop_back();
+				merged = true;
+				break;
+			}
+		}
+	}
+	windows.push_back(r);
+}
+
+void PyramidDetector::detect(const Mat &bgr, Rect window, Mat &coarseMask, vector<Blob> &blobs) {
+	int f = factor();
+	windows.clear();
+	if (f == 1) {
+		windows.push_back(window);
+		detector.detect(bgr, window, coarseMask, blobs);
+		return;
+	}
+
+	resize(bgr(window), small, Size(), 1.0 / f, 1.0 / f, INTER_NEAREST);
+	detector.detect(small, coarseMask, coarseBlobs);
+
+	int margin = 2 * f, minArea = minCoarseArea();
+	bool fullScan = false;
+	for (size_t i = 0; i < coarseBlobs.size() && !fullScan; i++) {
+		if (coarseBlobs[i].area < minArea)
+			continue;
+		Rect b = coarseBlobs[i].bounds();
+		Rect r(window.x + b.x * f - margin, window.y + b.y * f - margin,
+				b.width * f + 2 * margin, b.height * f + 2 * margin);
+		addWindow(r & window);
+		//stop before the merging gets long, it looks at every window for every one added
+		fullScan = (int)windows.size() > params.maxWindows;
+	}
+	double covered = 0;
+	for (size_t i = 0; i < windows.size(); i++)
+		covered += windows[i].area();
+	if (fullScan || covered > params.maxWindowShare * window.area()) {
+		windows.assign(1, window);
+		detector.detect(bgr, window, fineMask, blobs);
+		return;
+	}
+
+	blobs.clear();
+	for (size_t i = 0; i < windows.size(); i++) {
+		detector.detect(bgr, windows[i], fineMask, fineBlobs);
+		blobs.insert(blobs.end(), fineBlobs.begin(), fineBlobs.end());
+	}
+	sort(blobs.begin(), blobs.end(), firstPixelOrder);
+}
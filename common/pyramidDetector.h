@@ -0,0 +1,70 @@
+/*
+ * Coarse to fine balloon detector header file
+ * Description:
+ * Finds candidates on a downscaled copy of the frame, then runs the full
+ * resolution detector only in small windows around them. The scale factor
+ * (a power of two up to maxFactor) is picked from the smallest balloon that
+ * must still be found: a balloon with radius minRadius is still at least two
+ * coarse pixels across, so it can't fall between the samples. At 1/4 or 1/8
+ * the coarse pass costs 1/16 or 1/64 of a full frame pass, the fine windows
+ * only cost what the balloons in view cover.
+ *
+ * Note:
+ * - The downscale samples pixels (INTER_NEAREST), it does not average them.
+ *   Averaging mixes a small balloon with the background around it and would
+ *   lower its saturation below the threshold.
+ * - Fine windows are the coarse blobs scaled back up plus a margin of two
+ *   coarse pixels; windows that touch are merged so no blob is split or found twice.
+ * - Coarse blobs smaller than the fewest samples a disk of minRadius can
+ *   cover are noise and get no window.
+ * - More than maxWindows windows, or windows covering more than
+ *   maxWindowShare of the scan, and one full resolution pass over the whole
+ *   window is done instead. A noisy scene then costs a full pass plus the
+ *   coarse one rather than a window per speck.
+ * - The blobs are full resolution blobs in frame coordinates, in raster order.
+ */
+#ifndef PYRAMID_DETECTOR_INCLUDED
+#define PYRAMID_DETECTOR_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+#include "balloonDetector.h"
+
+using namespace std;
+using namespace cv;
+
+struct PyramidParams {
+	int minRadius;        //smallest balloon radius in full resolution pixels that has to be found
+	int maxFactor;        //largest downscale factor to use
+	int maxWindows;       //more fine windows than this and the whole window is scanned at full resolution
+	float maxWindowShare; //same when the fine windows cover more than this share of it
+
+	PyramidParams() : minRadius(4), maxFactor(8), maxWindows(16), maxWindowShare(0.5f) {}
+};
+
+class PyramidDetector {
+public:
+	PyramidDetector(BalloonDetector &detector, const PyramidParams &params = PyramidParams());
+
+	//downscale factor for the current params, 1 means no coarse pass
+	int factor() const;
+
+	//coarseMask is the candidate mask of the downscaled window
+	void detect(const Mat &bgr, Rect window, Mat &coarseMask, vector<Blob> &blobs);
+	//full resolution windows searched by the last detect
+	const vector<Rect> &fineWindows() const { return windows; }
+	//smallest coarse blob area that gets a fine window
+	int minCoarseArea();
+
+	PyramidParams params;
+
+private:
+	void addWindow(Rect r);
+
+	BalloonDetector &detector;
+	Mat small, fineMask;
+	vector<Blob> coarseBlobs, fineBlobs;
+	vector<Rect> windows;
+	int areaRadius, areaFactor, areaMin; //minCoarseArea() for minRadius and factor
+};
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Predictive search window
+ * Description:
+ * Window prediction and target selection for the search window scheduler.
+ * See roiScheduler.h.
+ */
+#include "roiScheduler.h"
+#include <math.h>
+
+RoiScheduler::RoiScheduler(const RoiParams &params) :
+		params(params), locked(false), fullScan(true), sinceFullScan(0), targetIndex(-1),
+		pos(0, 0), vel(0, 0), rad(0) {
+}
+
+bool RoiScheduler::isBalloon(const Blob &blob) const {
+	return blob.area >= params.minArea && blob.roundness() >= params.minRoundness;
+}
+
+Rect RoiScheduler::nextWindow(Size frameSize) {
+	Rect frame(Point(0, 0), frameSize);
+	fullScan = !locked || (params.rescanInterval > 0 && sinceFullScan >= params.rescanInterval);
+	if (fullScan) {
+		window = frame;
+		return window;
+	}
+
+	Point2f predicted = pos + vel;
+	float speed = sqrt(vel.x * vel.x + vel.y * vel.y);
+	int half = cvCeil(params.radiusScale * rad + params.velocityScale * speed) + params.margin;
+	window = Rect(cvFloor(predicted.x) - half, cvFloor(predicted.y) - half, 2 * half + 1, 2 * half + 1) & frame;
+	if (window.area() == 0)
+		window = frame; //prediction left the frame, go back to searching everywhere
+	fullScan = window == frame;
+	return window;
+}
+
+void RoiScheduler::update(const vector<Blob> &blobs) {
+	sinceFullScan = fullScan ? 0 : sinceFullScan + 1;
+
+	Point2f predicted = pos + vel;
+	targetIndex = -1;
+	double best = 0;
+	for (int i = 0; i < (int)blobs.size(); i++) {
+		if (!isBalloon(blobs[i]))
+			continue;
+		double score;
+		if (locked) {
+			Point2f d = blobs[i].centroid() - predicted;
+			score = -(d.x * d.x + d.y * d.y);
+		} else {
+			score = blobs[i].area;
+		}
+		if (targetIndex < 0 || score > best) {
+			targetIndex = i;
+			best = score;
+		}
+	}
+
+	if (targetIndex < 0) {
+		//lost it, the next frame is a full scan
+		locked = false;
+		vel = Point2f(0, 0);
+		return;
+	}
+
+	Point2f c = blobs[targetIndex].centroid();
+	if (locked)
+		vel = 0.5f * vel + 0.5f * (c - pos);
+	else
+		vel = Point2f(0, 0);
+	pos = c;
+	rad = blobs[targetIndex].radius();
+	locked = true;
+}
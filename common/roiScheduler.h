@@ -0,0 +1,73 @@
+/*
+ * Predictive search window header file
+ * Description:
+ * Decides where the detector looks in each frame. While no balloon is
+ * confirmed the whole frame is scanned. Once one is, only a window around
+ * where it should be next is scanned: the last centre plus its velocity,
+ * made big enough for the balloon's radius and for how fast it is moving.
+ * A full frame scan still runs every rescanInterval frames to pick up other
+ * balloons, and straight away when the balloon is not found in its window.
+ *
+ * Usage, per frame:
+ *    Rect window = scheduler.nextWindow(frame.size());
+ *    ... detect inside window ...
+ *    scheduler.update(blobs);
+ *
+ * Note:
+ * - A balloon is a blob with roundness >= minRoundness and area >= minArea.
+ *   When there are several the one nearest the prediction is tracked,
+ *   on a full scan with nothing tracked yet the biggest one.
+ * - Velocity is in pixels per frame, smoothed over a few frames.
+ */
+#ifndef ROI_SCHEDULER_INCLUDED
+#define ROI_SCHEDULER_INCLUDED
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "blobs.h"
+
+using namespace std;
+using namespace cv;
+
+struct RoiParams {
+	int rescanInterval;    //frames between forced full frame scans, 0 never forces one
+	float radiusScale;     //window half size is radiusScale * radius ...
+	float velocityScale;   //... + velocityScale * speed ...
+	int margin;            //... + margin pixels
+	double minRoundness;
+	int minArea;
+
+	RoiParams() : rescanInterval(30), radiusScale(2.0f), velocityScale(2.0f), margin(16),
+			minRoundness(0.65), minArea(20) {}
+};
+
+class RoiScheduler {
+public:
+	RoiScheduler(const RoiParams &params = RoiParams());
+
+	//where to look in the next frame
+	Rect nextWindow(Size frameSize);
+	//blobs found in the window returned by the last nextWindow, in frame coordinates
+	void update(const vector<Blob> &blobs);
+
+	bool tracking() const { return locked; }
+	bool lastWasFullScan() const { return fullScan; }
+	Point2f position() const { return pos; }
+	Point2f velocity() const { return vel; }
+	float radius() const { return rad; }
+	//index in the blobs of the last update of the tracked balloon, -1 if none
+	int target() const { return targetIndex; }
+
+	RoiParams params;
+
+private:
+	bool isBalloon(const Blob &blob) const;
+
+	bool locked;
+	bool fullScan;
+	int sinceFullScan;
+	int targetIndex;
+	Point2f pos, vel;
+	float rad;
+	Rect window;
+};
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Run time options
+ * Description:
+ * Command line parsing for the options in runOptions.h.
+ */
+#include "runOptions.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void printRunOptionsUsage(const char *program) {
+	fprintf(stderr, "usage: %s [options]\n"
+			"  --headless                           no windows, overlay or drawing\n"
+			"  --feed | --no-feed                   camera feed window\n"
+			"  --other                              intermediate plane windows\n"
+			"  --output | --no-output               overlay window\n"
+			"  --debug-draw | --no-debug-draw       draw rejected candidates\n"
+			"  --write-overlay | --no-write-overlay save the overlay\n"
+			"  --log-times                          per frame stage times\n"
+			"  --stats-every N                      stage latency table every N frames\n"
+			"  --detections PATH                    write detections to PATH (- for stdout)\n"
+			"  --binary                             binary detection records instead of csv\n"
+			"  --v4l2 | --no-v4l2                   mapped V4L2 capture or OpenCV capture\n"
+			"  --input camera[:N] | PATH.rec | PATH  camera, recording or video file\n"
+			"  --fast                               replay recordings as fast as they can be read\n"
+			"  --record PATH                        save every captured frame to a recording\n"
+			"  --out DIR                            directory saved overlays go to\n"
+			"  --compact-overlay                    save the primitives to draw instead of the drawn overlay\n"
+			"  --results PATH                       per image results, .json for json, csv otherwise\n"
+			"  --jobs N                             images at once in headless batch runs, 0 every core\n"
+			"  --cache DIR                          decoded image and result cache\n",
+			program);
+}
+
+bool parseRunOptions(int argc, char **argv, RunOptions &opts, vector<string> &rest) {
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		if (!strcmp(arg, "--headless")) {
+			opts.showFeed = opts.showOther = opts.showOutput = false;
+			opts.drawDebug = opts.writeOverlay = false;
+		} else if (!strcmp(arg, "--feed")) {
+			opts.showFeed = true;
+		} else if (!strcmp(arg, "--no-feed")) {
+			opts.showFeed = false;
+		} else if (!strcmp(arg, "--other")) {
+			opts.showOther = true;
+		} else if (!strcmp(arg, "--output")) {
+			opts.showOutput = true;
+		} else if (!strcmp(arg, "--no-output")) {
+			opts.showOutput = false;
+		} else if (!strcmp(arg, "--debug-draw")) {
+			opts.drawDebug = true;
+		} else if (!strcmp(arg, "--no-debug-draw")) {
+			opts.drawDebug = false;
+		} else if (!strcmp(arg, "--write-overlay")) {
+			opts.writeOverlay = true;
+		} else if (!strcmp(arg, "--no-write-overlay")) {
+			opts.writeOverlay = false;
+		} else if (!strcmp(arg, "--log-times")) {
+			opts.logTimes = true;
+		} else if (!strcmp(arg, "--stats-every") && i + 1 < argc) {
+			opts.statsInterval = atoi(argv[++i]);
+		} else if (!strcmp(arg, "--detections") && i + 1 < argc) {
+			opts.detectionsPath = argv[++i];
+		} else if (!strcmp(arg, "--binary")) {
+			opts.detectionsFormat = DETECTIONS_BINARY;
+		} else if (!strcmp(arg, "--v4l2")) {
+			opts.v4l2Capture = true;
+		} else if (!strcmp(arg, "--no-v4l2")) {
+			opts.v4l2Capture = false;
+		} else if (!strcmp(arg, "--input") && i + 1 < argc) {
+			opts.input = argv[++i];
+		} else if (!strcmp(arg, "--fast")) {
+			opts.replayFast = true;
+		} else if (!strcmp(arg, "--record") && i + 1 < argc) {
+			opts.recordPath = argv[++i];
+		} else if (!strcmp(arg, "--out") && i + 1 < argc) {
+			opts.outputDir = argv[++i];
+		} else if (!strcmp(arg, "--compact-overlay")) {
+			opts.compactOverlay = true;
+		} else if (!strcmp(arg, "--results") && i + 1 < argc) {
+			opts.resultsPath = argv[++i];
+		} else if (!strcmp(arg, "--jobs") && i + 1 < argc) {
+			opts.jobs = atoi(argv[++i]);
+		} else if (!strcmp(arg, "--cache") && i + 1 < argc) {
+			opts.cacheDir = argv[++i];
+		} else if (!strncmp(arg, "--", 2)) {
+			fprintf(stderr, "unknown option %s\n", arg);
+			printRunOptionsUsage(argv[0]);
+			return false;
+		} else {
+			rest.push_back(arg);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,73 @@
+/*
+ * Run time options header file
+ * Description:
+ * Command line switches shared by the balloon detection programs. They used
+ * to be the SHOW_FEED_WINDOW, SHOW_OTHER_WINDOWS, SHOW_OUTPUT_WINDOW,
+ * DRAW_DEBUG_DATA and PER_FRAME_TIME_LOGGING macros, so a flight build meant
+ * a recompile.
+ *
+ *    --headless          no windows, no overlay and no drawing at all
+ *    --feed / --no-feed  show the camera feed
+ *    --other             show the intermediate planes
+ *    --output / --no-output   show the overlay
+ *    --debug-draw / --no-debug-draw   draw the rejected candidates too
+ *    --write-overlay / --no-write-overlay   save the overlay (programs that do)
+ *    --log-times         print per frame stage times
+ *    --stats-every N     print the stage latency table every N frames
+ *    --detections PATH   write every frame's balloons to PATH, - for stdout
+ *    --binary            binary detection records instead of csv
+ *    --v4l2 / --no-v4l2  capture through mapped V4L2 buffers or OpenCV (programs with a camera)
+ *    --input SPEC        camera[:N], a PATH.rec recording or a video file (programs with a camera)
+ *    --fast              replay a recording as fast as it can be read, not at the recorded pace
+ *    --record PATH       save every captured frame to a recording, see frameInput.h
+ *    --out DIR           where saved overlays go (programs that save them)
+ *    --compact-overlay   save what would be drawn instead of the drawn image, see overlayWriter.h
+ *    --results PATH      per image results table, json when PATH ends in .json, csv otherwise
+ *    --jobs N            images worked on at once in headless batch runs, 0 for every core
+ *    --cache DIR         keep decoded images and results in DIR for the next run (programs on stills)
+ *
+ * Note:
+ * - Each program fills in its own defaults before parsing, the switches only
+ *   change what is given. Anything that is not a switch is left in rest.
+ */
+#ifndef RUN_OPTIONS_INCLUDED
+#define RUN_OPTIONS_INCLUDED
+#include <string>
+#include <vector>
+#include "detectionLog.h"
+
+using namespace std;
+
+struct RunOptions {
+	bool showFeed;
+	bool showOther;
+	bool showOutput;
+	bool drawDebug;
+	bool writeOverlay;
+	bool logTimes;
+	int statsInterval;       //frames between latency dumps, 0 for only at the end
+	string detectionsPath;   //empty for none, "-" for stdout
+	int detectionsFormat;    //DETECTIONS_CSV or DETECTIONS_BINARY
+	bool v4l2Capture;        //falls back to OpenCV capture when the camera can't be mapped
+	string input;            //empty for the camera
+	bool replayFast;
+	string recordPath;       //empty for not recording
+	string outputDir;        //empty for the program's default
+	bool compactOverlay;     //save overlay primitives instead of an encoded image
+	string resultsPath;      //empty for none, "-" for stdout
+	int jobs;
+	string cacheDir;         //empty for no cache
+
+	RunOptions() : showFeed(false), showOther(false), showOutput(true), drawDebug(true),
+			writeOverlay(false), logTimes(false), statsInterval(0), detectionsFormat(DETECTIONS_CSV),
+			v4l2Capture(true), replayFast(false), compactOverlay(false), jobs(0) {}
+
+	bool anyWindow() const { return showFeed || showOther || showOutput; }
+	//the overlay is only cloned and drawn on when something uses it
+	bool needOverlay() const { return showOutput || writeOverlay; }
+};
+
+//returns false and prints the usage on an unknown switch
+bool parseRunOptions(int argc, char **argv, RunOptions &opts, vector<string> &rest);
+void printRunOptionsUsage(const char *program);
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Thread pool
+ * Description:
+ * Worker start up and shut down, and the task hand out for parallelFor.
+ */
+#include "threadPool.h"
+
+ThreadPool::ThreadPool(int threads) :
+		job(0), jobCount(0), active(0), generation(0), stopping(false), next(0) {
+	if (threads <= 0)
+		threads = std::thread::hardware_concurrency();
+	for (int i = 1; i < threads; i++)
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void ThreadPool::runTasks(const std::function<void(int)> &task, int count) {
+	for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+		task(i);
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)> &task) {
+	if (workers.empty() || count <= 1) {
+		for (int i = 0; i < count; i++)
+			task(i);
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		job = &task;
+		jobCount = count;
+		next = 0;
+		active = (int)workers.size();
+		++generation;
+	}
+	wake.notify_all();
+
+	runTasks(task, count);
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (active > 0)
+		done.wait(guard);
+	job = 0;
+}
+
+void ThreadPool::workerLoop() {
+	unsigned seen = 0;
+	std::unique_lock<std::mutex> guard(lock);
+	for (;;) {
+		while (!stopping && generation == seen)
+			wake.wait(guard);
+		if (stopping)
+			return;
+		seen = generation;
+		const std::function<void(int)> *task = job;
+		int count = jobCount;
+
+		guard.unlock();
+		runTasks(*task, count);
+		guard.lock();
+
+		if (--active == 0)
+			done.notify_one();
+	}
+}
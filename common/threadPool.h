@@ -0,0 +1,47 @@
+/*
+ * Thread pool header file
+ * Description:
+ * A fixed set of worker threads for splitting one job into many small tasks.
+ * parallelFor() hands task indexes out one at a time from a shared counter,
+ * so threads that finish early take more tasks and uneven tasks still
+ * balance. The calling thread works on tasks too and returns once all are done.
+ *
+ * Note:
+ * - Needs C++11 (-std=c++11 -pthread).
+ * - One parallelFor at a time per pool, it is not reentrant.
+ */
+#ifndef THREAD_POOL_INCLUDED
+#define THREAD_POOL_INCLUDED
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+class ThreadPool {
+public:
+	//threads counts the calling thread, 0 uses every core
+	ThreadPool(int threads = 0);
+	~ThreadPool();
+
+	int size() const { return (int)workers.size() + 1; }
+
+	//runs task(i) for every i in [0, count)
+	void parallelFor(int count, const std::function<void(int)> &task);
+
+private:
+	void workerLoop();
+	void runTasks(const std::function<void(int)> &task, int count);
+
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake, done;
+	const std::function<void(int)> *job;
+	int jobCount;
+	int active;              //workers still on the current job
+	unsigned generation;     //bumped for every job so workers see a new one
+	bool stopping;
+	std::atomic<int> next;   //next task index to hand out
+};
+#endif
@@ -0,0 +1,218 @@
+/*
+ * V4L2 capture
+ * Description:
+ * mmap streaming capture with buffers handed out as frame views. See
+ * v4l2Capture.h.
+ */
+#include "v4l2Capture.h"
+#include "latency.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * the open device and its mapped buffers. Shared by the source and every
+ * buffer a view holds, so it is unmapped and closed by whoever lets go last
+ */
+struct V4l2Device {
+	int fd;
+	vector<void *> starts;
+	vector<size_t> lengths;
+	bool streaming;
+
+	V4l2Device() : fd(-1), streaming(false) {}
+
+	~V4l2Device() {
+		if (streaming) {
+			enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			ioctl(fd, VIDIOC_STREAMOFF, &type);
+		}
+		for (size_t i = 0; i < starts.size(); i++)
+			munmap(starts[i], lengths[i]);
+		if (fd >= 0)
+			::close(fd);
+	}
+
+	bool queue(int index) {
+		struct v4l2_buffer buf;
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = index;
+		return xioctl(VIDIOC_QBUF, &buf);
+	}
+
+	bool xioctl(unsigned long request, void *arg) {
+		int r;
+		do {
+			r = ioctl(fd, request, arg);
+		} while (r < 0 && errno == EINTR);
+		return r >= 0;
+	}
+};
+
+/*
+ * what a view holds on to for a zero copy frame, queues the buffer back on release
+ */
+struct V4l2BufferHold {
+	std::shared_ptr<V4l2Device> device;
+	int index;
+
+	V4l2BufferHold(const std::shared_ptr<V4l2Device> &device, int index) : device(device), index(index) {}
+	~V4l2BufferHold() { device->queue(index); }
+};
+
+V4l2FrameSource::V4l2FrameSource() : bytesPerLine(0), zeroCopy(false) {
+}
+
+V4l2FrameSource::~V4l2FrameSource() {
+	close();
+}
+
+static bool setFormat(V4l2Device &dev, Size size, unsigned pixelFormat, struct v4l2_format &fmt) {
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	fmt.fmt.pix.width = size.width;
+	fmt.fmt.pix.height = size.height;
+	fmt.fmt.pix.pixelformat = pixelFormat;
+	fmt.fmt.pix.field = V4L2_FIELD_NONE;
+	return dev.xioctl(VIDIOC_S_FMT, &fmt) && fmt.fmt.pix.pixelformat == pixelFormat;
+}
+
+bool V4l2FrameSource::open(const string &path, Size size, int buffers) {
+	close();
+	std::shared_ptr<V4l2Device> dev(new V4l2Device());
+	dev->fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+	if (dev->fd < 0) {
+		perror(path.c_str());
+		return false;
+	}
+
+	struct v4l2_capability cap;
+	if (!dev->xioctl(VIDIOC_QUERYCAP, &cap) || !(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) ||
+			!(cap.capabilities & V4L2_CAP_STREAMING)) {
+		fprintf(stderr, "%s: no streaming video capture\n", path.c_str());
+		return false;
+	}
+
+	//bgr24 is what the detector takes, so views can point straight into the buffers
+	struct v4l2_format fmt;
+	if (setFormat(*dev, size, V4L2_PIX_FMT_BGR24, fmt)) {
+		zeroCopy = true;
+	} else if (setFormat(*dev, size, V4L2_PIX_FMT_YUYV, fmt)) {
+		zeroCopy = false;
+	} else {
+		fprintf(stderr, "%s: neither bgr24 nor yuyv capture\n", path.c_str());
+		return false;
+	}
+	frameSize = Size(fmt.fmt.pix.width, fmt.fmt.pix.height);
+	bytesPerLine = fmt.fmt.pix.bytesperline;
+	if (bytesPerLine == 0)
+		bytesPerLine = frameSize.width * (zeroCopy ? 3 : 2);
+
+	struct v4l2_requestbuffers req;
+	memset(&req, 0, sizeof(req));
+	req.count = buffers;
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_MMAP;
+	if (!dev->xioctl(VIDIOC_REQBUFS, &req) || req.count < 2) {
+		fprintf(stderr, "%s: no mmap buffers\n", path.c_str());
+		return false;
+	}
+
+	for (unsigned i = 0; i < req.count; i++) {
+		struct v4l2_buffer buf;
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if (!dev->xioctl(VIDIOC_QUERYBUF, &buf))
+			return false;
+		void *start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, dev->fd, buf.m.offset);
+		if (start == MAP_FAILED) {
+			perror("mmap");
+			return false;
+		}
+		dev->starts.push_back(start);
+		dev->lengths.push_back(buf.length);
+		if (!dev->queue(i))
+			return false;
+	}
+
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (!dev->xioctl(VIDIOC_STREAMON, &type)) {
+		perror("VIDIOC_STREAMON");
+		return false;
+	}
+	dev->streaming = true;
+	device = dev;
+	return true;
+}
+
+void V4l2FrameSource::close() {
+	//views still out keep the device open, it goes when the last of them does
+	device.reset();
+}
+
+bool V4l2FrameSource::read(FrameView &frame, int64 &stamp) {
+	if (!device)
+		return false;
+
+	struct v4l2_buffer buf;
+	for (;;) {
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(device->fd, &fds);
+		struct timeval tv;
+		tv.tv_sec = V4L2_READ_TIMEOUT_MS / 1000;
+		tv.tv_usec = (V4L2_READ_TIMEOUT_MS % 1000) * 1000;
+		int r = select(device->fd + 1, &fds, NULL, NULL, &tv);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0) {
+			perror("select");
+			return false;
+		}
+		if (r == 0) {
+			fprintf(stderr, "v4l2: no frame in %d ms\n", V4L2_READ_TIMEOUT_MS);
+			return false;
+		}
+
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		if (device->xioctl(VIDIOC_DQBUF, &buf))
+			break;
+		if (errno != EAGAIN) {
+			perror("VIDIOC_DQBUF");
+			return false;
+		}
+	}
+
+	//driver stamps are taken when the frame arrived, use them when they are on our clock
+	stamp = monotonicMicros();
+#ifdef V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
+	if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+		stamp = int64(buf.timestamp.tv_sec) * 1000000 + buf.timestamp.tv_usec;
+#endif
+
+	void *start = device->starts[buf.index];
+	if (zeroCopy) {
+		Mat image(frameSize, CV_8UC3, start, bytesPerLine);
+		frame = FrameView(image, std::shared_ptr<void>(new V4l2BufferHold(device, buf.index)));
+	} else {
+		Mat yuyv(frameSize, CV_8UC2, start, bytesPerLine);
+		Mat image = pool.next(frameSize, CV_8UC3);
+		cvtColor(yuyv, image, CV_YUV2BGR_YUYV);
+		device->queue(buf.index);
+		frame = FrameView(image);
+	}
+	return true;
+}
@@ -0,0 +1,66 @@
+/*
+ * V4L2 capture header file
+ * Description:
+ * Frame source that maps the driver's capture buffers (V4L2 mmap streaming)
+ * instead of going through VideoCapture, which copies every frame out of the
+ * driver buffer into its own and then again into the caller's Mat.
+ *
+ * When the camera delivers BGR24 the view handed out points straight into
+ * the mapped buffer. The buffer is only queued back to the driver when the
+ * last view of it is released, so every stage that holds the frame (mailbox,
+ * detector, display queue) keeps it from being overwritten. YUYV cameras get
+ * one conversion out of the mapped buffer into a pooled BGR Mat and the
+ * driver buffer goes straight back.
+ *
+ * Usage:
+ *    V4l2FrameSource camera;
+ *    if (!camera.open("/dev/video0", Size(1280, 720))) ...fall back to CvFrameSource
+ *    FrameView frame; int64 stamp;
+ *    while (camera.read(frame, stamp)) { ...use frame.image()...; frame.release(); }
+ *
+ * Note:
+ * - Cameras that only do MJPEG (or anything else) fail open(), the caller
+ *   falls back to CvFrameSource.
+ * - The mapping and the device stay alive until the source and every view
+ *   of it are gone, views may outlive the source.
+ * - read() fails if no buffer is filled within V4L2_READ_TIMEOUT_MS, which
+ *   also happens when every buffer is held by views for that long.
+ * - Linux only.
+ */
+#ifndef V4L2_CAPTURE_INCLUDED
+#define V4L2_CAPTURE_INCLUDED
+#include <string>
+#include <memory>
+#include "frameSource.h"
+
+using namespace std;
+using namespace cv;
+
+const int V4L2_CAPTURE_BUFFERS = 8;  //buffers asked of the driver, it may give fewer
+const int V4L2_READ_TIMEOUT_MS = 2000;
+
+struct V4l2Device;
+
+class V4l2FrameSource : public FrameSource {
+public:
+	V4l2FrameSource();
+	~V4l2FrameSource();
+
+	bool open(const string &device, Size size, int buffers = V4L2_CAPTURE_BUFFERS);
+	bool isOpened() const { return device.get() != NULL; }
+	void close();
+
+	bool read(FrameView &frame, int64 &stamp);
+	Size size() const { return frameSize; }
+	const char *name() const { return zeroCopy ? "v4l2 mmap bgr24" : "v4l2 mmap yuyv"; }
+	//true when views point into the driver's buffers
+	bool isZeroCopy() const { return zeroCopy; }
+
+private:
+	std::shared_ptr<V4l2Device> device;
+	Size frameSize;
+	size_t bytesPerLine;
+	bool zeroCopy;
+	FramePool pool;
+};
+#endif
@@ -13,6 +13,8 @@
 #include <opencv2/gpu/gpu.hpp>
 #include "cannyEdge.h"
 #include "houghLine.h"
+#include "../common/colorLUT.h"
+#include "../common/frameInput.h"
 
 #include <iostream>
 #include <stdlib.h>
@@ -62,94 +64,43 @@ string trackbarWindow;
 string windowName;
 
 
-/*
- * function to open a VideoCapture with given video filename
- * **unfinished, barely used**
- */
-void getVideoFromFile(std::string filename, VideoCapture dest)
-{
-	if (dest.open(filename) == false) {
-		cerr << "Cannot open image file " << filename << endl;
-		dest.release();
-		return;
-	}
-	if (dest.isOpened()){
-		cout << "Successfully opened " << filename << endl;
-	}
-}
-
-
-/*
- * function to set up camera settings before operation
- * **Currently not working. Setting width and height doesn't work**
- */
-void cameraSetup(VideoCapture &capture)
-{
-	//params.filterByColor = true;
-	//params.blobColor = 86;
-
-	//properties supported by VideoCapture::set for my setup
-	// frame width, height, brightness[0 - 1], contrast, saturation, hue, gain
-
-	//seems like these calls don't do anything? res doesn't change
-	capture.set(CV_CAP_PROP_FRAME_WIDTH, cam_width);
-	capture.set(CV_CAP_PROP_FRAME_HEIGHT, cam_height);
-	cout << "Width: " << capture.get(CV_CAP_PROP_FRAME_WIDTH) << endl;
-	cout << "Height: " << capture.get(CV_CAP_PROP_FRAME_HEIGHT) << endl;
-}
-
 /*
  * function to filter/mask orange colors from frame
  * input: 3 channel rgb Mat frame
  * output: 3 channel rgb Mat frame with orange filter mask applied
  * description:
- *  - converts the original frame in HSV color format
- *  - applies hard-coded thresholds to each channel
- *  - masks original image with threshold mask
+ *  - classifies every pixel with the colour lookup table (one read per pixel,
+ *    the table is built the first time through)
+ *  - the orange range is given in the HSV space CV_RGB2HSV produces for our
+ *    BGR frames, like the old threshold chain did
+ *  - masks original image with the orange mask
  */
 Mat filterOrange(Mat frame)
 {
-	GpuMat gpuFrame(frame);
-	GpuMat convertedHue;
-	gpu::cvtColor(gpuFrame, convertedHue, CV_RGB2HSV);
-
-	vector<GpuMat> hsv_split;
-	gpu::split(convertedHue, hsv_split);
-
-	GpuMat hue, sat, val;
-	hsv_split[0].copyTo(hue);
-	hsv_split[1].copyTo(sat);
-	hsv_split[2].copyTo(val);
-
-	int min_hue = 100;
-	int max_hue = 120;
-	int min_sat = 100;
-	int max_sat = 255;
-	int min_val = 40;
-	int max_val = 255;
-
-	//apply threshold to each channel
-	GpuMat hue1, hue2, sat1, sat2, val1, val2, binaries;
-	gpu::threshold(hsv_split[0], hue1, min_hue, 179, THRESH_BINARY);
-	gpu::threshold(hsv_split[0], hue2, max_hue, 179, THRESH_BINARY_INV);
-	gpu::bitwise_and(hue1, hue2, hsv_split[0]);
-	gpu::threshold(hsv_split[1], sat1, min_sat, 255, THRESH_BINARY);
-	gpu::threshold(hsv_split[1], sat2, max_sat, 255, THRESH_BINARY_INV);
-	gpu::bitwise_and(sat1, sat2, hsv_split[1]);
-	gpu::threshold(hsv_split[2], val1, min_sat, 255, THRESH_BINARY);
-	gpu::threshold(hsv_split[2], val2, max_sat, 255, THRESH_BINARY_INV);
-	gpu::bitwise_and(val1, val2, hsv_split[2]);
-	//combine binaries
-	gpu::bitwise_and(hsv_split[0], hsv_split[1], binaries);
-	gpu::bitwise_and(hsv_split[2], binaries, binaries);
+	static ColorLUT lut;
+	static int orange = -1;
+
+	if (orange < 0) {
+		int min_hue = 100;
+		int max_hue = 120;
+		int min_sat = 100;
+		int max_sat = 255;
+		//the threshold chain compared val against the sat limits, kept so the mask stays the same
+		int min_val = min_sat;
+		int max_val = max_sat;
+
+		//the thresholds were exclusive at the bottom (THRESH_BINARY is >), the table range is inclusive
+		orange = lut.addRange("orange", Scalar(min_hue + 1, min_sat + 1, min_val + 1),
+				Scalar(max_hue, max_sat, max_val), CV_RGB2HSV);
+		lut.build();
+	}
 
-	//mask original image with binary
-	GpuMat finalGpu;
-	gpuFrame.copyTo(finalGpu, binaries);
-	//binaries.copyTo(finalGpu);
+	Mat binaries;
+	lut.mask(frame, orange, binaries);
 
+	//mask original image with binary
 	Mat final;
-	finalGpu.download(final);
+	frame.copyTo(final, binaries);
 	return final;
 }
 
@@ -296,14 +247,21 @@ Mat applyAll(Mat frame)
 /*
  * main function
  * description: original design to take in source from either command line or camera feed.
- * - If command argument exists, treat it as a video or image file
+ * - If command argument exists, treat it as an image file, or a video or
+ *   recording when it isn't one
  *   - Apply all defined transformations on image or video
- * - Else, source is camera feed. Infinit loop
+ * - Else, source is camera feed (or what --input names, see common/frameInput.h).
+ *   Loops until a key is hit or the video ends
  */
 int main(int argc, char *argv[])
 {
-	if (argc > 1) { //use files from input command as source instead
-		inputFile = argv[1];
+	FrameInputOptions inputOptions;
+	vector<string> args;
+	if (!parseFrameInputOptions(argc, argv, inputOptions, args)) {
+		exit(1);
+	}
+	if (!args.empty()) { //use files from input command as source instead
+		inputFile = args[0];
 
 		cur_frame = imread(inputFile.c_str(), CV_LOAD_IMAGE_COLOR);
 		if (cur_frame.data != NULL) {   //try opening as image
@@ -313,19 +271,19 @@ int main(int argc, char *argv[])
 			trackbarWindow = inputFile + " trackbar";
 			namedWindow(trackbarWindow.c_str(), WINDOW_NORMAL);
 			cur_frame_applied = applyAll(cur_frame);
-		} else {   //try opening as video
-			VideoCapture vid;
-			getVideoFromFile(inputFile.c_str(), vid);
-				//work on this later. not needed now
-		}		
-		waitKey(0);
-		destroyAllWindows();
-		exit(0);
+			waitKey(0);
+			destroyAllWindows();
+			exit(0);
+		}
+		//not an image, read it as a video or recording below
+		inputOptions.input = inputFile;
 	}
 
-	/************************  using camera as source (below)  *********************/
-	VideoCapture cap(0);
-	if (!cap.isOpened()) {
+	/*****************  using camera, video or recording as source (below)  ****************/
+	FrameInput cap;
+	FrameView view;
+	int64 stamp;
+	if (!cap.open(inputOptions, Size(cam_width, cam_height))) {
 		cerr << "Error connecting to a camera device" << endl;
 		exit(0);
 	}
@@ -334,7 +292,8 @@ int main(int argc, char *argv[])
 	resizeWindow(windowName, cam_width, cam_height);
 	trackbarWindow = "trackbar";
 	namedWindow(trackbarWindow, WINDOW_NORMAL);
-	cameraSetup(cap);
+	cout << "Width: " << cap.size().width << endl;
+	cout << "Height: " << cap.size().height << endl;
 
 	cout << "In capture ..." << endl;
 #ifdef CALC_FPS
@@ -347,7 +306,12 @@ int main(int argc, char *argv[])
 #endif
 	int keyPress;
 	while (true) {
-		cap.read(cur_frame);
+		if (!cap.read(view, stamp)) {
+			break;
+		}
+		//the filters may draw on their input, keep them off the capture buffer
+		view.image().copyTo(cur_frame);
+		view.release();
 #ifdef SHOW_RAW
 		imshow("raw", cur_frame);
 #endif